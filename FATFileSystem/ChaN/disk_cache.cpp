@@ -0,0 +1,130 @@
+/*-----------------------------------------------------------------------*/
+/* Sector Cache                                                          */
+/*-----------------------------------------------------------------------*/
+/* A write-through LRU cache of single sectors, _DISK_CACHE slots of     */
+/* _MAX_SS bytes. Sectors of the FAT and of the FAT12/16 root directory  */
+/* are pinned: only another pinned sector may take their slot, and they  */
+/* may fill all but one slot.                                            */
+/*-----------------------------------------------------------------------*/
+
+#include <string.h>
+#include "disk_cache.h"
+
+#if _DISK_CACHE
+#define CACHE_MAX_PINNED ((_DISK_CACHE > 1) ? _DISK_CACHE - 1 : 1)
+
+typedef struct {
+    BYTE  used;
+    BYTE  pdrv;
+    BYTE  pinned;
+    DWORD sector;
+    DWORD stamp;                    /* Last use, for LRU */
+} CACHE_SLOT;
+
+static CACHE_SLOT cache[_DISK_CACHE];
+static BYTE cache_buf[_DISK_CACHE][_MAX_SS] _DISK_CACHE_ATTR;   /* Sector data of each slot */
+#define SLOT_BUF(slot) cache_buf[(slot) - cache]
+static DWORD cache_clock;
+static DWORD cache_hits;
+static DWORD cache_misses;
+
+static CACHE_SLOT* cache_find (BYTE pdrv, DWORD sector)
+{
+    for (int i = 0; i < _DISK_CACHE; i++) {
+        if (cache[i].used && cache[i].pdrv == pdrv && cache[i].sector == sector)
+            return &cache[i];
+    }
+    return NULL;
+}
+
+/* Slot for a new sector, or NULL if it shouldn't be cached */
+static CACHE_SLOT* cache_victim (BYTE pinned)
+{
+    CACHE_SLOT *victim = NULL;
+    int n_pinned = 0;
+
+    for (int i = 0; i < _DISK_CACHE; i++) {
+        if (!cache[i].used)
+            return &cache[i];
+        if (cache[i].pinned)
+            n_pinned++;
+    }
+    for (int i = 0; i < _DISK_CACHE; i++) {
+        /* Unpinned sectors only replace unpinned ones, pinned ones take an
+           unpinned slot until they hold CACHE_MAX_PINNED, then each other's */
+        BYTE full = pinned && n_pinned >= CACHE_MAX_PINNED;
+        if (cache[i].pinned != full)
+            continue;
+        if (victim == NULL || cache[i].stamp < victim->stamp)
+            victim = &cache[i];
+    }
+    return victim;
+}
+#endif
+
+int cache_read (const CACHE_DEV* dev, BYTE pdrv, BYTE* buff, DWORD sector, UINT count)
+{
+#if _DISK_CACHE
+    if (count == 1) {
+        CACHE_SLOT *slot = cache_find(pdrv, sector);
+        if (slot) {
+            cache_hits++;
+            slot->stamp = ++cache_clock;
+            memcpy(buff, SLOT_BUF(slot), _MAX_SS);
+            return 0;
+        }
+        cache_misses++;
+        if (dev->read(pdrv, buff, sector, count))
+            return -1;
+        BYTE pinned = dev->pinned(pdrv, sector);
+        slot = cache_victim(pinned);
+        if (slot) {
+            slot->used = 1;
+            slot->pdrv = pdrv;
+            slot->pinned = pinned;
+            slot->sector = sector;
+            slot->stamp = ++cache_clock;
+            memcpy(SLOT_BUF(slot), buff, _MAX_SS);
+        }
+        return 0;
+    }
+#endif
+    return dev->read(pdrv, buff, sector, count) ? -1 : 0;
+}
+
+int cache_write (const CACHE_DEV* dev, BYTE pdrv, const BYTE* buff, DWORD sector, UINT count)
+{
+    if (dev->write(pdrv, buff, sector, count)) {
+        cache_invalidate(pdrv, sector, count);     /* The disk may hold either version now */
+        return -1;
+    }
+#if _DISK_CACHE
+    /* Write-through: keep any cached copies identical to the disk */
+    for (int i = 0; i < _DISK_CACHE; i++) {
+        if (cache[i].used && cache[i].pdrv == pdrv && cache[i].sector >= sector && cache[i].sector - sector < count)
+            memcpy(cache_buf[i], buff + (cache[i].sector - sector) * _MAX_SS, _MAX_SS);
+    }
+#endif
+    return 0;
+}
+
+void cache_invalidate (BYTE pdrv, DWORD sector, UINT count)
+{
+#if _DISK_CACHE
+    for (int i = 0; i < _DISK_CACHE; i++) {
+        if (cache[i].used && cache[i].pdrv == pdrv && cache[i].sector >= sector && cache[i].sector - sector < count)
+            cache[i].used = 0;
+    }
+#endif
+}
+
+void disk_cache_stats (DWORD* hits, DWORD* misses)
+{
+#if _DISK_CACHE
+    *hits = cache_hits;
+    *misses = cache_misses;
+#else
+    *hits = 0;
+    *misses = 0;
+#endif
+}
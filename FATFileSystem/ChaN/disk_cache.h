@@ -0,0 +1,43 @@
+/*-----------------------------------------------------------------------/
+/  Write-through LRU sector cache between FatFs and a block device      /
+/-----------------------------------------------------------------------*/
+
+#ifndef _DISK_CACHE_DEFINED
+#define _DISK_CACHE_DEFINED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "integer.h"
+#include "ffconf.h"
+
+
+/* The block device under the cache. read and write return 0 on success,
+   pinned tells whether a sector holds the FAT or the FAT12/16 root directory */
+typedef struct {
+	int  (*read) (BYTE pdrv, BYTE* buff, DWORD sector, UINT count);
+	int  (*write) (BYTE pdrv, const BYTE* buff, DWORD sector, UINT count);
+	BYTE (*pinned) (BYTE pdrv, DWORD sector);
+} CACHE_DEV;
+
+
+/*---------------------------------------*/
+/* Prototypes for the cache functions    */
+
+/* Single sectors come from the cache where possible, multi-sector reads go
+   straight to the device and leave the cache alone. Return 0 on success */
+int cache_read (const CACHE_DEV* dev, BYTE pdrv, BYTE* buff, DWORD sector, UINT count);
+
+/* Writes go through to the device and update any cached copies, or drop
+   them if the device fails. Return 0 on success */
+int cache_write (const CACHE_DEV* dev, BYTE pdrv, const BYTE* buff, DWORD sector, UINT count);
+
+void cache_invalidate (BYTE pdrv, DWORD sector, UINT count);
+void disk_cache_stats (DWORD* hits, DWORD* misses);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -8,11 +8,35 @@
 /*-----------------------------------------------------------------------*/
 
 #include "diskio.h"
+#include "disk_cache.h"
 #include "mbed_debug.h"
 #include "FATFileSystem.h"
 
 using namespace mbed;
 
+/*-----------------------------------------------------------------------*/
+/* Sector Cache Device                                                   */
+/*-----------------------------------------------------------------------*/
+
+static int dev_read (BYTE pdrv, BYTE* buff, DWORD sector, UINT count)
+{
+    return FATFileSystem::_ffs[pdrv]->disk_read((uint8_t*)buff, sector, count);
+}
+
+static int dev_write (BYTE pdrv, const BYTE* buff, DWORD sector, UINT count)
+{
+    return FATFileSystem::_ffs[pdrv]->disk_write((const uint8_t*)buff, sector, count);
+}
+
+/* The FAT and the FAT12/16 root directory sit between fatbase and database */
+static BYTE dev_pinned (BYTE pdrv, DWORD sector)
+{
+    FATFS *fs = &FATFileSystem::_ffs[pdrv]->_fs;
+    return fs->fs_type && sector >= fs->fatbase && sector < fs->database;
+}
+
+static const CACHE_DEV cache_dev = { dev_read, dev_write, dev_pinned };
+
 /*-----------------------------------------------------------------------*/
 /* Get Drive Status                                                      */
 /*-----------------------------------------------------------------------*/
@@ -34,6 +58,7 @@ DSTATUS disk_initialize (
 )
 {
     debug_if(FFS_DBG, "disk_initialize on pdrv [%d]\n", pdrv);
+    cache_invalidate(pdrv, 0, 0xFFFFFFFF);        /* Possibly a different card */
     return (DSTATUS)FATFileSystem::_ffs[pdrv]->disk_initialize();
 }
 
@@ -49,7 +74,7 @@ DRESULT disk_read (
 )
 {
     debug_if(FFS_DBG, "disk_read(sector %d, count %d) on pdrv [%d]\n", sector, count, pdrv);
-    if (FATFileSystem::_ffs[pdrv]->disk_read((uint8_t*)buff, sector, count))
+    if (cache_read(&cache_dev, pdrv, buff, sector, count))
         return RES_PARERR;
     else
         return RES_OK;
@@ -68,7 +93,7 @@ DRESULT disk_write (
 )
 {
     debug_if(FFS_DBG, "disk_write(sector %d, count %d) on pdrv [%d]\n", sector, count, pdrv);
-    if (FATFileSystem::_ffs[pdrv]->disk_write((uint8_t*)buff, sector, count))
+    if (cache_write(&cache_dev, pdrv, buff, sector, count))
         return RES_PARERR;
     else
         return RES_OK;
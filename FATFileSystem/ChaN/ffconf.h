@@ -45,7 +45,7 @@
 /* This option switches f_mkfs() function. (0:Disable or 1:Enable) */
 
 
-#define	_USE_FASTSEEK	0
+#define	_USE_FASTSEEK	1
 /* This option switches fast seek feature. (0:Disable or 1:Enable) */
 
 
@@ -202,6 +202,19 @@
 /  data transfer. */
 
 
+#define	_DISK_CACHE		2
+/* Number of sectors held in the write-through LRU cache between FatFs and the
+/  disk driver (disk_cache.cpp), _MAX_SS bytes of RAM each. (0:Disable)
+/  Sectors of the FAT and of the FAT12/16 root directory are pinned: only
+/  another pinned sector may take their slot, and they may fill all but one
+/  slot. Multi-sector transfers go straight to the disk. */
+
+
+#define	_DISK_CACHE_ATTR	__attribute__((section(".usbram")))
+/* Placement of the cache buffers, in the idle USB RAM bank of the LPC11U37
+/  (see LPC11U37.ld). Leave it empty for ordinary RAM. */
+
+
 #define _FS_NORTC	0
 #define _NORTC_MON	1
 #define _NORTC_MDAY	1
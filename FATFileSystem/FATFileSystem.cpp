@@ -42,7 +42,7 @@ DWORD get_fattime(void) {
 
 FATFileSystem *FATFileSystem::_ffs[_VOLUMES] = {0};
 
-FATFileSystem::FATFileSystem(const char* n) : FileSystemLike(n) {
+FATFileSystem::FATFileSystem(const char* n) : FileSystemLike(n), _clmt(NULL), _clmt_size(0) {
     debug_if(FFS_DBG, "FATFileSystem(%s)\n", n);
     for(int i=0; i<_VOLUMES; i++) {
         if(_ffs[i] == 0) {
@@ -69,7 +69,9 @@ FATFileSystem::~FATFileSystem() {
 FileHandle *FATFileSystem::open(const char* name, int flags) {
     debug_if(FFS_DBG, "open(%s) on filesystem [%s], drv [%s]\n", name, getName(), _fsid);
     char n[64];
-    sprintf(n, "%s:/%s", _fsid, name);
+    strcpy(n, _fsid);                   // "<drive>:/<name>", without pulling in sprintf
+    strcat(n, ":/");
+    strncat(n, name, sizeof(n) - strlen(n) - 1);
 
     /* POSIX flags -> FatFS open mode */
     BYTE openmode;
@@ -88,6 +90,10 @@ FileHandle *FATFileSystem::open(const char* name, int flags) {
         }
     }
 
+    /* The link map is for this open only, whether or not it gets used */
+    DWORD *clmt = _clmt;
+    _clmt = NULL;
+
     FIL *fh;
     FATFileHandle *fatFileHandleObj = new FATFileHandle();
     fh = fatFileHandleObj->GetFIL();
@@ -99,9 +105,24 @@ FileHandle *FATFileSystem::open(const char* name, int flags) {
     if (flags & O_APPEND) {
         f_lseek(fh, fh->fsize);
     }
+    if (clmt && (openmode == FA_READ)) {
+        /* Map the cluster chain once, fast seek mode is read only */
+        fh->cltbl = clmt;
+        clmt[0] = _clmt_size;
+        res = f_lseek(fh, CREATE_LINKMAP);
+        if (res) {
+            debug_if(FFS_DBG, "CREATE_LINKMAP failed: %d, needs %d\n", res, clmt[0]);
+            fh->cltbl = 0;
+        }
+    }
     return fatFileHandleObj;
 }
 
+void FATFileSystem::set_fastseek_table(DWORD *table, UINT size) {
+    _clmt = table;
+    _clmt_size = size;
+}
+
 int FATFileSystem::open(FileHandle **file, const char *name, int flags) {
     FileHandle *temp = open(name, flags);
     if (!temp) {
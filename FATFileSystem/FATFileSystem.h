@@ -47,6 +47,16 @@ public:
      */
     virtual FileHandle *open(const char* name, int flags);
     virtual int open(FileHandle **file, const char *name, int flags);
+
+    /**
+     * Gives the next file opened read-only a cluster link map, so seeking in
+     * it doesn't walk the FAT chain. table holds size DWORDs (2 per fragment
+     * plus 2) and must stay valid until that file is closed. A file too
+     * fragmented for the table falls back to normal seeking. The next open
+     * drops the table whatever happens, so an open that fails or writes
+     * never hands it on to a later file.
+     */
+    void set_fastseek_table(DWORD *table, UINT size);
     
     /**
      * Removes a file path
@@ -91,6 +101,9 @@ public:
     virtual int disk_sync() { return 0; }
     virtual uint32_t disk_sectors() = 0;
 
+protected:
+    DWORD *_clmt;                            // link map for the next read-only open, NULL for none
+    UINT _clmt_size;
 };
 
 #endif
@@ -61,9 +61,8 @@
  * This is set with CMD16.
  *
  * You can read and write single blocks (CMD17, CMD25) or multiple blocks
- * (CMD18, CMD25). For simplicity, I'll just use single block accesses. When
- * the card gets a read command, it responds with a response token, and then
- * a data token or an error.
+ * (CMD18, CMD25). When the card gets a read command, it responds with a
+ * response token, and then a data token or an error.
  *
  * SPI Command Format
  * ------------------
@@ -111,21 +110,61 @@
  * +------+---------+---------+- -  - -+---------+-----------+----------+
  * | 0xFE | data[0] | data[1] |        | data[n] | crc[15:8] | crc[7:0] |
  * +------+---------+---------+- -  - -+---------+-----------+----------+
+ *
+ * Multiple Block Read
+ * -------------------
+ *
+ * Reads of more than one sector use CMD18, which makes the card send one
+ * data block after the other, each with its own start token, until it is
+ * stopped with CMD12. That saves a command and its access latency on every
+ * sector after the first. Each start token is waited for with a timeout and
+ * a data error token (0000xxxx) aborts the transfer.
+ *
+ * Multiple Block Write
+ * --------------------
+ *
+ * Writes of more than one sector are announced with the block count
+ * (ACMD23, so the card can pre-erase) and sent with CMD25. Each block
+ * starts with 0xFC instead of 0xFE and the card is busy (zeros) while it
+ * programs it. The transfer ends with the stop tran token 0xFD, after which
+ * the card is busy again until everything is written. The busy waits are
+ * bounded so a failed card can't hang the caller.
+ *
+ * Transfer Clock
+ * --------------
+ *
+ * The CSD TRAN_SPEED field gives the card's maximum clock as a unit and a
+ * multiplier. SCK is set to the fastest rate the SSP can make exactly
+ * (PCLK / 2n) that doesn't exceed it. The CSD is then read back at that
+ * clock and compared with the copy read at the init clock; if it doesn't
+ * match, SCK is halved and tried again, down to the init clock.
+ *
+ * The card always sends a CRC-16 (CCITT, zero start) after each data block,
+ * even with command CRCs off, and every block read is checked against it.
+ * A read that fails its CRC, a token or the timeout is retried at the same
+ * clock; only SD_READ_RETRIES failures in a row halve SCK, so a single
+ * glitch doesn't cost the rest of the session half the bus.
  */
 #include "SDFileSystem.h"
 #include "mbed_debug.h"
 
 #define SD_COMMAND_TIMEOUT 5000
+#define SD_READ_TIMEOUT_MS 100      // longest the card may take to start a data block
+#define SD_WRITE_TIMEOUT_MS 500     // longest the card may stay busy programming
+#define SD_INIT_TIMEOUT_MS 1000     // longest the card may take to leave idle (ACMD41)
+#define SD_POLL_MAX_MS 32           // longest wait between ACMD41 polls
+#define SD_READ_RETRIES 3           // failed reads in a row before SCK is halved
 
 #define SD_DBG             0
 
 SDFileSystem::SDFileSystem(PinName mosi, PinName miso, PinName sclk, PinName cs, const char* name) :
     FATFileSystem(name), _spi(mosi, miso, sclk), _cs(cs), _is_initialized(0) {
     _cs = 1;
+    memset(&_report, 0, sizeof(_report));
 
-    // Set default to 100kHz for initialisation and 1MHz for data transfer
+    // Set default to 100kHz for initialisation, data transfer is set from the CSD
     _init_sck = 100000;
-    _transfer_sck = 1000000;
+    _transfer_sck = 0;
 }
 
 #define R1_IDLE_STATE           (1 << 0)
@@ -146,40 +185,76 @@ SDFileSystem::SDFileSystem(PinName mosi, PinName miso, PinName sclk, PinName cs,
 #define SDCARD_V2   2
 #define SDCARD_V2HC 3
 
-int SDFileSystem::initialise_card() {
-    // Set to SCK for initialisation, and clock card with cs = 1
-    _spi.frequency(_init_sck);
-    _cs = 1;
-    for (int i = 0; i < 16; i++) {
-        _spi.write(0xFF);
+// CRC-16/CCITT of the data blocks, a byte at a time
+static const uint16_t crc16_table[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+
+static uint16_t data_crc(const uint8_t *data, uint32_t length) {
+    uint16_t crc = 0;
+
+    while (length--) {
+        crc = (crc << 8) ^ crc16_table[((crc >> 8) ^ *data++) & 0xFF];
     }
+    return crc;
+}
 
-    // send CMD0, should return with all zeros except IDLE STATE set (bit 0)
-    if (_cmd(0, 0) != R1_IDLE_STATE) {
-        debug("No disk, or could not put SD card in to SPI idle state\n");
-        return SDCARD_FAIL;
-    }
+int SDFileSystem::_poll_acmd41(int arg) {
+    // ACMD41 until the card leaves idle, polling quickly at first and
+    // backing off to SD_POLL_MAX_MS, for at most SD_INIT_TIMEOUT_MS
+    Timer deadline;
+    int interval = 1;
 
-    // send CMD8 to determine whther it is ver 2.x
-    int r = _cmd8();
-    if (r == R1_IDLE_STATE) {
-        return initialise_card_v2();
-    } else if (r == (R1_IDLE_STATE | R1_ILLEGAL_COMMAND)) {
-        return initialise_card_v1();
-    } else {
-        debug("Not in idle state after sending CMD8 (not an SD card?)\n");
-        return SDCARD_FAIL;
+    deadline.start();
+    while (deadline.read_ms() < SD_INIT_TIMEOUT_MS) {
+        _cmd(55, 0);
+        if (_cmd(41, arg) == 0) {
+            return 0;
+        }
+        wait_ms(interval);
+        if (interval < SD_POLL_MAX_MS) {
+            interval <<= 1;
+        }
     }
+    return -1;
 }
 
 int SDFileSystem::initialise_card_v1() {
-    for (int i = 0; i < SD_COMMAND_TIMEOUT; i++) {
-        _cmd(55, 0);
-        if (_cmd(41, 0) == 0) {
-            cdv = 512;
-            debug_if(SD_DBG, "\n\rInit: SEDCARD_V1\n\r");
-            return SDCARD_V1;
-        }
+    if (_poll_acmd41(0) == 0) {
+        cdv = 512;
+        debug_if(SD_DBG, "\n\rInit: SEDCARD_V1\n\r");
+        return SDCARD_V1;
     }
 
     debug("Timeout waiting for v1.x card\n");
@@ -187,16 +262,12 @@ int SDFileSystem::initialise_card_v1() {
 }
 
 int SDFileSystem::initialise_card_v2() {
-    for (int i = 0; i < SD_COMMAND_TIMEOUT; i++) {
-        wait_ms(50);
+    _cmd58();
+    if (_poll_acmd41(0x40000000) == 0) {
         _cmd58();
-        _cmd(55, 0);
-        if (_cmd(41, 0x40000000) == 0) {
-            _cmd58();
-            debug_if(SD_DBG, "\n\rInit: SDCARD_V2\n\r");
-            cdv = 1;
-            return SDCARD_V2;
-        }
+        debug_if(SD_DBG, "\n\rInit: SDCARD_V2\n\r");
+        cdv = 1;
+        return SDCARD_V2;
     }
 
     debug("Timeout waiting for v2.x card\n");
@@ -204,42 +275,140 @@ int SDFileSystem::initialise_card_v2() {
 }
 
 int SDFileSystem::disk_initialize() {
-    _is_initialized = initialise_card();
-    if (_is_initialized == 0) {
-        debug("Fail to initialize card\n");
-        return 1;
+    Timer timer;
+    int phase = SD_PHASE_CMD0;
+    int version = 0;
+    int r;
+
+    _is_initialized = 0;
+    for (r = SD_PHASE_CMD0; r < SD_PHASE_MOUNT; r++) {
+        _report.us[r] = 0;
     }
-    debug_if(SD_DBG, "init card = %d\n", _is_initialized);
-    _sectors = _sd_sectors();
+    _report.result = SD_INIT_OK;
 
-    // Set block length to 512 (CMD16)
-    if (_cmd(16, 512) != 0) {
-        debug("Set 512-byte block timed out\n");
-        return 1;
+    // Set to SCK for initialisation, and clock card with cs = 1
+    _spi.frequency(_init_sck);
+    _cs = 1;
+    for (int i = 0; i < 16; i++) {
+        _spi.write(0xFF);
     }
 
-    // Set SCK for data transfer
-    _spi.frequency(_transfer_sck);
+    // every phase is bounded, so the whole init is too
+    timer.start();
+    while ((phase < SD_PHASE_MOUNT) && (_report.result == SD_INIT_OK)) {
+        timer.reset();
+        switch (phase) {
+            case SD_PHASE_CMD0:
+                // send CMD0, should return with all zeros except IDLE STATE set (bit 0)
+                if (_cmd(0, 0) != R1_IDLE_STATE) {
+                    debug("No disk, or could not put SD card in to SPI idle state\n");
+                    _report.result = SD_INIT_NO_CARD;
+                }
+                break;
+
+            case SD_PHASE_CMD8:
+                // send CMD8 to determine whther it is ver 2.x
+                r = _cmd8();
+                if (r == R1_IDLE_STATE) {
+                    version = 2;
+                } else if (r == (R1_IDLE_STATE | R1_ILLEGAL_COMMAND)) {
+                    version = 1;
+                } else {
+                    debug("Not in idle state after sending CMD8 (not an SD card?)\n");
+                    _report.result = SD_INIT_NOT_SD;
+                }
+                break;
+
+            case SD_PHASE_ACMD41:
+                _is_initialized = (version == 2) ? initialise_card_v2() : initialise_card_v1();
+                if (_is_initialized == SDCARD_FAIL) {
+                    _report.result = SD_INIT_TIMEOUT;
+                }
+                break;
+
+            case SD_PHASE_CSD:
+                _sectors = _sd_sectors();
+                if (_sectors == 0) {
+                    _report.result = SD_INIT_CSD;
+                }
+                // Set block length to 512 (CMD16)
+                else if (_cmd(16, 512) != 0) {
+                    debug("Set 512-byte block timed out\n");
+                    _report.result = SD_INIT_BLOCK_LEN;
+                }
+                // Set SCK for data transfer
+                else if (_select_sck() != 0) {
+                    debug("No working transfer clock\n");
+                    _report.result = SD_INIT_SCK;
+                }
+                break;
+        }
+        _report.us[phase] = timer.read_us();
+        phase++;
+    }
+
+    if (_report.result != SD_INIT_OK) {
+        _is_initialized = 0;
+        return 1;
+    }
+    debug_if(SD_DBG, "init card = %d\n", _is_initialized);
     return 0;
 }
 
+int SDFileSystem::mount() {
+    Timer timer;
+
+    timer.start();
+    int r = FATFileSystem::mount();
+    _report.us[SD_PHASE_MOUNT] = timer.read_us();
+    if ((r != 0) && (_report.result == SD_INIT_OK)) {
+        _report.result = SD_INIT_MOUNT;
+    }
+    return r;
+}
+
 int SDFileSystem::disk_write(const uint8_t* buffer, uint32_t block_number, uint32_t count) {
     if (!_is_initialized) {
         return -1;
     }
     
-    for (uint32_t b = block_number; b < block_number + count; b++) {
+    if (count == 1) {
         // set write address for single block (CMD24)
-        if (_cmd(24, b * cdv) != 0) {
+        if (_cmd(24, block_number * cdv) != 0) {
             return 1;
         }
         
         // send the data block
-        _write(buffer, 512);
+        return _write(buffer, 512);
+    }
+
+    // let the card pre-erase the blocks (ACMD23), only a hint so the result doesn't matter
+    _cmd(55, 0);
+    _cmd(23, count);
+
+    // set write address for multiple blocks (CMD25), keeping the card selected
+    if (_cmdx(25, block_number * cdv) != 0) {
+        return 1;
+    }
+
+    int result = 0;
+    for (uint32_t b = 0; b < count; b++) {
+        if (_write_block(0xFC, buffer, 512) != 0) {
+            result = 1;
+            break;
+        }
         buffer += 512;
     }
-    
-    return 0;
+
+    // stop tran token, then wait for the card to finish programming
+    _spi.write(0xFD);
+    _spi.write(0xFF);
+    if (_wait_ready(SD_WRITE_TIMEOUT_MS) != 0) {
+        result = 1;
+    }
+    _cs = 1;
+    _spi.write(0xFF);
+    return result;
 }
 
 int SDFileSystem::disk_read(uint8_t* buffer, uint32_t block_number, uint32_t count) {
@@ -247,17 +416,60 @@ int SDFileSystem::disk_read(uint8_t* buffer, uint32_t block_number, uint32_t cou
         return -1;
     }
     
-    for (uint32_t b = block_number; b < block_number + count; b++) {
-        // set read address for single block (CMD17)
-        if (_cmd(17, b * cdv) != 0) {
+    // retry a failed read, and slow down if it keeps failing
+    int failures = 0;
+    int r;
+    while ((r = _read_sectors(buffer, block_number, count)) != 0) {
+        if (r < 0) {
+            return 1;                   // refused, no clock will fix that
+        }
+        if (++failures < SD_READ_RETRIES) {
+            continue;
+        }
+        failures = 0;
+        if (_step_down_sck() != 0) {
             return 1;
         }
+    }
+    return 0;
+}
+
+int SDFileSystem::_read_sectors(uint8_t* buffer, uint32_t block_number, uint32_t count) {
+    int r;
+
+    if (count == 1) {
+        // set read address for single block (CMD17)
+        r = _cmd(17, block_number * cdv);
+        if (r != 0) {
+            return ((r > 0) && (r & (R1_ADDRESS_ERROR | R1_PARAMETER_ERROR))) ? -1 : 1;
+        }
         
         // receive the data
-        _read(buffer, 512);
+        return _read(buffer, 512);
+    }
+
+    // set read address for multiple blocks (CMD18), keeping the card selected
+    r = _cmdx(18, block_number * cdv);
+    if (r != 0) {
+        if (r > 0) {
+            _cs = 1;
+            _spi.write(0xFF);
+        }
+        return ((r > 0) && (r & (R1_ADDRESS_ERROR | R1_PARAMETER_ERROR))) ? -1 : 1;
+    }
+
+    for (uint32_t b = 0; b < count; b++) {
+        if (_read_block(buffer, 512) != 0) {
+            _cmd12();
+            return 1;
+        }
         buffer += 512;
     }
 
+    // stop the transmission (CMD12)
+    if (_cmd12() != 0) {
+        return 1;
+    }
     return 0;
 }
 
@@ -323,6 +535,38 @@ int SDFileSystem::_cmdx(int cmd, int arg) {
 }
 
 
+int SDFileSystem::_cmd12() {
+    _cs = 0;
+
+    // send a command
+    _spi.write(0x40 | 12);
+    _spi.write(0x00);
+    _spi.write(0x00);
+    _spi.write(0x00);
+    _spi.write(0x00);
+    _spi.write(0x95);
+    _spi.write(0xFF); // stuff byte, the card may still be clocking out data
+
+    // wait for the repsonse (response[7] == 0)
+    for (int i = 0; i < SD_COMMAND_TIMEOUT; i++) {
+        int response = _spi.write(0xFF);
+        if (!(response & 0x80)) {
+            // R1b, wait for the card to release busy
+            for (int j = 0; j < SD_COMMAND_TIMEOUT; j++) {
+                if (_spi.write(0xFF) != 0) {
+                    _cs = 1;
+                    _spi.write(0xFF);
+                    return response;
+                }
+            }
+            break;
+        }
+    }
+    _cs = 1;
+    _spi.write(0xFF);
+    return -1; // timeout
+}
+
 int SDFileSystem::_cmd58() {
     _cs = 0;
     int arg = 0;
@@ -365,7 +609,7 @@ int SDFileSystem::_cmd8() {
     _spi.write(0x87);     // crc
 
     // wait for the repsonse (response[7] == 0)
-    for (int i = 0; i < SD_COMMAND_TIMEOUT * 1000; i++) {
+    for (int i = 0; i < SD_COMMAND_TIMEOUT; i++) {
         char response[5];
         response[0] = _spi.write(0xFF);
         if (!(response[0] & 0x80)) {
@@ -384,32 +628,54 @@ int SDFileSystem::_cmd8() {
 
 int SDFileSystem::_read(uint8_t *buffer, uint32_t length) {
     _cs = 0;
+    int result = _read_block(buffer, length);
+    _cs = 1;
+    _spi.write(0xFF);
+    return result;
+}
 
-    // read until start byte (0xFF)
-    while (_spi.write(0xFF) != 0xFE);
+int SDFileSystem::_read_block(uint8_t *buffer, uint32_t length) {
+    Timer timeout;
+    int token;
 
-    // read data
-    for (uint32_t i = 0; i < length; i++) {
-        buffer[i] = _spi.write(0xFF);
+    // read until start byte (0xFE), an error token or the timeout
+    timeout.start();
+    while ((token = _spi.write(0xFF)) == 0xFF) {
+        if (timeout.read_ms() > SD_READ_TIMEOUT_MS) {
+            debug("Timeout waiting for data block\n");
+            return 1;
+        }
+    }
+    if (token != 0xFE) {
+        debug("Data error token %02x\n", token);
+        return 1;
     }
-    _spi.write(0xFF); // checksum
-    _spi.write(0xFF);
 
-    _cs = 1;
-    _spi.write(0xFF);
+    // read data, clocking out 0xFF through the FIFO
+    _spi.write(NULL, 0, (char *)buffer, length);
+    uint16_t crc = _spi.write(0xFF) << 8;
+    crc |= _spi.write(0xFF);
+    if (crc != data_crc(buffer, length)) {
+        debug("Data CRC error\n");
+        return 1;
+    }
     return 0;
 }
 
 int SDFileSystem::_write(const uint8_t*buffer, uint32_t length) {
     _cs = 0;
+    int result = _write_block(0xFE, buffer, length);
+    _cs = 1;
+    _spi.write(0xFF);
+    return result;
+}
 
+int SDFileSystem::_write_block(int token, const uint8_t*buffer, uint32_t length) {
     // indicate start of block
-    _spi.write(0xFE);
+    _spi.write(token);
 
-    // write the data
-    for (uint32_t i = 0; i < length; i++) {
-        _spi.write(buffer[i]);
-    }
+    // write the data through the FIFO
+    _spi.write((const char *)buffer, length, NULL, 0);
 
     // write the checksum
     _spi.write(0xFF);
@@ -417,16 +683,23 @@ int SDFileSystem::_write(const uint8_t*buffer, uint32_t length) {
 
     // check the response token
     if ((_spi.write(0xFF) & 0x1F) != 0x05) {
-        _cs = 1;
-        _spi.write(0xFF);
         return 1;
     }
 
     // wait for write to finish
-    while (_spi.write(0xFF) == 0);
+    return _wait_ready(SD_WRITE_TIMEOUT_MS);
+}
 
-    _cs = 1;
-    _spi.write(0xFF);
+int SDFileSystem::_wait_ready(int timeout_ms) {
+    Timer timeout;
+
+    timeout.start();
+    while (_spi.write(0xFF) == 0) {
+        if (timeout.read_ms() > timeout_ms) {
+            debug("Timeout waiting for card to finish programming\n");
+            return 1;
+        }
+    }
     return 0;
 }
 
@@ -455,7 +728,7 @@ uint32_t SDFileSystem::_sd_sectors() {
         return 0;
     }
 
-    uint8_t csd[16];
+    uint8_t *csd = _csd;
     if (_read(csd, 16) != 0) {
         debug("Couldn't read csd response from disk\n");
         return 0;
@@ -495,4 +768,63 @@ uint32_t SDFileSystem::_sd_sectors() {
             return 0;
     };
     return blocks;
-}
\ No newline at end of file
+}
+int SDFileSystem::_select_sck() {
+    // TRAN_SPEED multipliers times 10, the unit is 100 kbit/s << (3 * bits[2:0])
+    static const uint8_t tran_value[16] = {0, 10, 12, 13, 15, 20, 25, 30, 35, 40, 45, 50, 55, 60, 70, 80};
+
+    if (_transfer_sck == 0) {
+        // tran_speed : csd[103:96]
+        uint32_t tran_speed = ext_bits(_csd, 103, 96);
+        uint32_t card_hz = 10000 * tran_value[(tran_speed >> 3) & 0x0F];
+        for (uint32_t i = 0; i < (tran_speed & 0x07); i++) {
+            card_hz *= 10;
+        }
+        if (card_hz == 0) {
+            card_hz = 1000000;      // unreadable CSD, use the old fixed clock
+        }
+
+        // fastest PCLK / 2n at or below the card's limit
+        uint32_t n = (SystemCoreClock + 2 * card_hz - 1) / (2 * card_hz);
+        _transfer_sck = SystemCoreClock / (2 * n);
+    }
+
+    _spi.frequency(_transfer_sck);
+    int failures = 0;
+    while (_check_sck() != 0) {
+        if (++failures < SD_READ_RETRIES) {
+            continue;
+        }
+        failures = 0;
+        if (_step_down_sck() != 0) {
+            return 1;
+        }
+    }
+    debug_if(SD_DBG, "SCK %d Hz\n", _transfer_sck);
+    return 0;
+}
+
+int SDFileSystem::_step_down_sck() {
+    if (_transfer_sck / 2 < _init_sck) {
+        return 1;
+    }
+    _transfer_sck /= 2;
+    _spi.frequency(_transfer_sck);
+    debug_if(SD_DBG, "SCK down to %d Hz\n", _transfer_sck);
+    return 0;
+}
+
+int SDFileSystem::_check_sck() {
+    uint8_t csd[16];
+
+    // read the CSD again at the transfer clock, it must match the one read at the init clock
+    if (_cmdx(9, 0) != 0) {
+        _cs = 1;
+        _spi.write(0xFF);
+        return 1;
+    }
+    if (_read(csd, 16) != 0) {
+        return 1;
+    }
+    return memcmp(csd, _csd, 16) ? 1 : 0;
+}
@@ -26,6 +26,30 @@
 #include "FATFileSystem.h"
 #include <stdint.h>
 
+// Results of the card initialisation, see SDFileSystem::init_report()
+#define SD_INIT_OK          0
+#define SD_INIT_NO_CARD     1   // no reply to CMD0
+#define SD_INIT_NOT_SD      2   // bad reply to CMD8
+#define SD_INIT_TIMEOUT     3   // card never left idle (ACMD41)
+#define SD_INIT_CSD         4   // CSD unreadable or unsupported
+#define SD_INIT_BLOCK_LEN   5   // CMD16 failed
+#define SD_INIT_SCK         6   // no transfer clock passed the read-back check
+#define SD_INIT_MOUNT       7   // card fine but no FAT volume
+
+// Phases of the initialisation, timed separately. MOUNT covers the whole
+// mount(), including the card phases when they ran inside it.
+#define SD_PHASE_CMD0       0
+#define SD_PHASE_CMD8       1
+#define SD_PHASE_ACMD41     2
+#define SD_PHASE_CSD        3
+#define SD_PHASE_MOUNT      4
+#define SD_PHASES           5
+
+typedef struct {
+    int result;                 // SD_INIT_xxx
+    uint32_t us[SD_PHASES];     // time spent in each phase
+} sd_init_report_t;
+
 /** Access the filesystem on an SD Card using SPI
  *
  * @code
@@ -59,23 +83,40 @@ public:
     virtual int disk_sync();
     virtual uint32_t disk_sectors();
 
+    /** Mount the filesystem, timing it for the init report */
+    virtual int mount();
+
+    /** Outcome and phase timing of the last initialisation and mount */
+    const sd_init_report_t &init_report() const { return _report; }
+
 protected:
 
     int _cmd(int cmd, int arg);
     int _cmdx(int cmd, int arg);
     int _cmd8();
+    int _cmd12();
     int _cmd58();
-    int initialise_card();
+    int _poll_acmd41(int arg);
     int initialise_card_v1();
     int initialise_card_v2();
 
+    int _read_sectors(uint8_t* buffer, uint32_t block_number, uint32_t count);
     int _read(uint8_t * buffer, uint32_t length);
+    int _read_block(uint8_t * buffer, uint32_t length);
     int _write(const uint8_t *buffer, uint32_t length);
+    int _write_block(int token, const uint8_t *buffer, uint32_t length);
+    int _wait_ready(int timeout_ms);
     uint32_t _sd_sectors();
     uint32_t _sectors;
+    uint8_t _csd[16];
+
+    int _select_sck();
+    int _step_down_sck();
+    int _check_sck();
 
     void set_init_sck(uint32_t sck) { _init_sck = sck; }
-    // Note: The highest SPI clock rate is 20 MHz for MMC and 25 MHz for SD
+    // Note: The highest SPI clock rate is 20 MHz for MMC and 25 MHz for SD,
+    // leave it at 0 to take it from the card's CSD
     void set_transfer_sck(uint32_t sck) { _transfer_sck = sck; }
     uint32_t _init_sck;
     uint32_t _transfer_sck;
@@ -84,6 +125,7 @@ protected:
     DigitalOut _cs;
     int cdv;
     int _is_initialized;
+    sd_init_report_t _report;
 };
 
 #endif
\ No newline at end of file
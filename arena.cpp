@@ -0,0 +1,57 @@
+#include "arena.h"
+
+extern "C" byte __arena_start__[];
+extern "C" byte __arena_end__[];
+
+static word arena_used;
+static word arena_lent;                     /* Borrowed off the top. */
+static word arena_peak;
+
+static void arena_mark(void) {
+    if (arena_used + arena_lent > arena_peak) {
+        arena_peak = arena_used + arena_lent;
+    }
+}
+
+void arena_reset(void) {
+    arena_used = 0;
+}
+
+void *arena_alloc(word size) {
+    arena_used = (arena_used + 3) & ~3;     // after arena_extend()
+    return arena_extend((size + 3) & ~3);
+}
+
+void *arena_extend(word size) {
+    void *ptr;
+
+    if (size > arena_size() - arena_lent - arena_used) {
+        return 0;
+    }
+    ptr = &__arena_start__[arena_used];
+    arena_used += size;
+    arena_mark();
+    return ptr;
+}
+
+void *arena_borrow(word size) {
+    size = (size + 3) & ~3;
+    if ((arena_lent != 0) || (size > arena_size() - ((arena_used + 3) & ~3))) {
+        return 0;
+    }
+    arena_lent = size;
+    arena_mark();
+    return __arena_end__ - arena_lent;
+}
+
+void arena_return(void) {
+    arena_lent = 0;
+}
+
+word arena_size(void) {
+    return __arena_end__ - __arena_start__;
+}
+
+word arena_high_water(void) {
+    return arena_peak;
+}
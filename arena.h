@@ -0,0 +1,33 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "types.h"
+
+/* Bump allocator for the sequence step buffers, carved out of the .arena
+   section the linker script reserves in RAM (ARENA_SIZE there). Nothing is
+   freed on its own: a new load starts with arena_reset(), which drops
+   everything handed out before, so a repeated or failed load can't leak.
+   The high-water mark shows how close the sequences come to the limit. */
+
+void arena_reset(void);
+
+/* size bytes, 4-byte aligned, or NULL if they don't fit. */
+void *arena_alloc(word size);
+
+/* size more bytes straight after the last ones handed out, unaligned, or
+   NULL if they don't fit. For buffers built up a piece at a time whose
+   final size isn't known up front. */
+void *arena_extend(word size);
+
+/* size bytes off the top of the arena for scratch space that is only
+   needed while a load runs, such as the seq.txt line buffer. It survives
+   arena_reset(), so the steps can be packed in from the bottom meanwhile,
+   and shrinks the room they have until arena_return(). One at a time;
+   NULL if it doesn't fit or one is already out. */
+void *arena_borrow(word size);
+void arena_return(void);
+
+word arena_size(void);
+word arena_high_water(void);    /* Most bytes ever in use at once, borrowed ones included. */
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef CRC16_H
+#define CRC16_H
+
+#include "types.h"
+
+/* CRC-16/CCITT, one byte at a time. Start from 0xFFFF. Shared by the slave
+   sequence transfer and seq.bin (seq_convert.py computes the same thing). */
+static inline word crc16(word crc, byte c) {
+    byte i;
+
+    crc ^= (word)c << 8;
+    for (i = 0; i < 8; i++) {
+        crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+    }
+    return crc & 0xFFFF;
+}
+
+#endif
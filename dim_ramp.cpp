@@ -0,0 +1,69 @@
+#include "dim_ramp.h"
+
+/* For each channel the magnitude of (stop - start) * clocks is kept as a
+   quotient and remainder of total. When a step begins clocks == total, so
+   the quotient is the full span. Each crossing takes one span off, which is
+   span / total off the quotient and span % total off the remainder, with a
+   borrow when the remainder runs out. Both are worked out once per step. */
+
+static byte ramp_start[8];
+static byte ramp_down[8];       /* Ramping towards a lower level (stop < start). */
+static byte ramp_q[8];          /* |stop - start| * clocks / total */
+static word ramp_r[8];          /* |stop - start| * clocks % total */
+static byte ramp_dq[8];         /* |stop - start| / total */
+static word ramp_dr[8];         /* |stop - start| % total */
+static word ramp_total;
+
+void ramp_begin(const sDimStep *ptrStep, word total) {
+    int i;
+    byte span;
+
+    if (total == 0) {           /* a 0 tick step or speed, over in one crossing */
+        total = 1;
+    }
+    ramp_total = total;
+
+    for (i = 0; i < 8; i++) {
+        ramp_start[i] = ptrStep->Chan[i].start;
+        if (ptrStep->Chan[i].stop < ptrStep->Chan[i].start) {
+            ramp_down[i] = TRUE;
+            span = ptrStep->Chan[i].start - ptrStep->Chan[i].stop;
+        }
+        else {
+            ramp_down[i] = FALSE;
+            span = ptrStep->Chan[i].stop - ptrStep->Chan[i].start;
+        }
+        ramp_q[i] = span;
+        ramp_r[i] = 0;
+        ramp_dq[i] = span / total;
+        ramp_dr[i] = span % total;
+    }
+}
+
+void ramp_advance(void) {
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        if (ramp_r[i] < ramp_dr[i]) {
+            ramp_q[i] -= ramp_dq[i] + 1;
+            ramp_r[i] += ramp_total - ramp_dr[i];
+        }
+        else {
+            ramp_q[i] -= ramp_dq[i];
+            ramp_r[i] -= ramp_dr[i];
+        }
+    }
+}
+
+void ramp_countdowns(byte *countdown) {
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        if (ramp_down[i]) {
+            countdown[i] = 255 - (ramp_start[i] - ramp_q[i]);
+        }
+        else {
+            countdown[i] = 255 - (ramp_start[i] + ramp_q[i]);
+        }
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef DIM_RAMP_H
+#define DIM_RAMP_H
+
+#include "types.h"
+#include "dim_steps.h"
+
+/* Steps the brightness of all eight channels along a dimming step one zero
+   crossing at a time without dividing in the interrupt. The level at a given
+   clock is the same start + ((stop - start) * clocks) / total the crossing
+   ISRs used to evaluate, truncation included. */
+
+void ramp_begin(const sDimStep *ptrStep, word total);   // clocks == total, 0 is taken as 1
+void ramp_advance(void);                                // clocks - 1
+void ramp_countdowns(byte *countdown);                  // 255 - level for each channel
+
+#endif
@@ -1,3 +1,5 @@
+#ifndef DIM_STEPS_H
+#define DIM_STEPS_H
 
 #include "types.h"
 
@@ -11,5 +13,20 @@ typedef struct {
     sDimChanStep Chan[8];
     } sDimStep;
 
+/* The step that pads out a sequence announced longer than it is: the levels
+   the last step ended on, held for one tick, or all off if there was no last
+   step. Never 0 ticks, which would leave the ramp nothing to divide by. */
+static inline void dim_step_hold(sDimStep *pad, const sDimStep *last) {
+    int i;
+
+    pad->ticks = 1;
+    for (i = 0; i < 8; i++) {
+        pad->Chan[i].start = (last != 0) ? last->Chan[i].stop : 0;
+        pad->Chan[i].stop = pad->Chan[i].start;
+    }
+}
+
 // sDimStep *ptrDimSequences[16];
 // word DimSequenceLengths[16];
+
+#endif
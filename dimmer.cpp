@@ -0,0 +1,143 @@
+#include "mbed.h"
+#include "dimmer.h"
+#include "lights.h"
+#include "gate_api.h"
+
+/* Rather than a SLICE ticker counting every channel down ~240 times a cycle,
+   the slot in which each channel turns on is worked out once at the zero
+   crossing and one timer compare is programmed per distinct slot. The old
+   slice interrupt turned a channel on at slice (countdown + 1) and turned
+   everything off at slice LAST_SLICE + 1, so the events land on exactly the
+   same slice boundaries.
+
+   The cycle is rendered up front into a short table of edges, each holding
+   the slice and the complete port byte to write there, so the timer
+   interrupt only writes the next byte and re-arms itself.
+
+   Channels whose pin has a timer match output (PinMap_GATE) don't need any
+   interrupt at all: their gate timer is restarted at the zero crossing and
+   the match pulls the gate on in hardware. Only the remaining channels go
+   through the edge table. */
+
+typedef struct {
+    byte slot;          /* Slice at which the outputs change. */
+    byte port;          /* Lights port byte from that slice on. */
+    } sDimEdge;
+
+class DimmerEvent : public TimerEvent {
+public:
+    /* A zero crossing can come in again while the last cycle's event is
+       still queued (a slow or noisy edge), so take it off the list first. */
+    void schedule(us_timestamp_t timestamp) {
+        remove();
+        insert_absolute(timestamp);
+    }
+
+protected:
+    virtual void handler(void);
+};
+
+static DimmerEvent tmr_Dimmer;
+static dimmer_done_t cycle_done;
+
+static gate_t gates[DIMMER_CHANNELS];
+static byte hw_channels;                        /* Channels driven by a timer match output. */
+
+static us_timestamp_t zc_time;                  /* Start of the current cycle. */
+static sDimEdge wave[DIMMER_CHANNELS + 1];      /* Output changes in ascending slice order, the last one ends the cycle. */
+static sDimEdge *next_edge;
+
+void DimmerEvent::handler(void) {
+    sDimEdge *edge = next_edge;
+    byte i;
+
+    lights_write_port(edge->port);
+
+    if (edge->slot > LAST_SLICE) {                  // past the last slice, shut everything off for the next cycle
+        for (i = 0; i < DIMMER_CHANNELS; i++) {
+            if (hw_channels & (1 << i)) {
+                gate_off(&gates[i]);
+            }
+        }
+        cycle_done();
+        return;
+    }
+
+    next_edge = edge + 1;
+    insert_absolute(zc_time + next_edge->slot * SLICE);
+}
+
+void dimmer_init(const PinName *pins, dimmer_done_t done) {
+    byte i;
+
+    cycle_done = done;
+
+    hw_channels = 0;
+    for (i = 0; i < DIMMER_CHANNELS; i++) {
+        if (gate_init(&gates[i], pins[i])) {
+            hw_channels |= 1 << i;
+        }
+    }
+}
+
+void dimmer_start(const byte *countdown) {
+    byte i, j, k, n;
+    byte slot;
+    byte port;
+
+    gate_stop();                                    // hold the gate timers while their matches are updated
+    for (i = 0; i < DIMMER_CHANNELS; i++) {
+        if (hw_channels & (1 << i)) {
+            if (countdown[i] < LAST_SLICE) {
+                gate_arm(&gates[i], (countdown[i] + 1) * SLICE);
+            }
+            else {
+                gate_off(&gates[i]);
+            }
+        }
+    }
+
+    zc_time = ticker_read_us(get_us_ticker_data());
+    gate_start();
+
+    /* Sort the firing slots, collecting the port bits of the channels that
+       turn on in each one. */
+    n = 0;
+    for (i = 0; i < DIMMER_CHANNELS; i++) {
+        if (hw_channels & (1 << i)) {
+            continue;
+        }
+        if (countdown[i] >= LAST_SLICE) {           // too dim to turn on before the end of the cycle
+            continue;
+        }
+        slot = countdown[i] + 1;
+
+        for (j = 0; (j < n) && (wave[j].slot < slot); j++);
+
+        if ((j < n) && (wave[j].slot == slot)) {    // share the compare with a channel firing at the same time
+            wave[j].port |= CHANNELS_TO_PORT(1 << i);
+        }
+        else {
+            for (k = n; k > j; k--) {
+                wave[k] = wave[k - 1];
+            }
+            wave[j].slot = slot;
+            wave[j].port = CHANNELS_TO_PORT(1 << i);
+            n++;
+        }
+    }
+
+    /* Turn the bits into the running port byte (active low, so a channel
+       stays cleared once it has turned on). */
+    port = 0xFF;
+    for (j = 0; j < n; j++) {
+        port &= ~wave[j].port;
+        wave[j].port = port;
+    }
+
+    wave[n].slot = LAST_SLICE + 1;
+    wave[n].port = 0xFF;                            // C0-C7 all off (but they'll stay on until the ZC occurs)
+    next_edge = wave;
+
+    tmr_Dimmer.schedule(zc_time + wave[0].slot * SLICE);
+}
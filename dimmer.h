@@ -0,0 +1,17 @@
+#ifndef DIMMER_H
+#define DIMMER_H
+
+#include "mbed.h"
+#include "types.h"
+
+#define DIMMER_CHANNELS 8
+#define SLICE 65            // usec for slices of a half AC cycle
+#define LAST_SLICE 241      // the last slice that can turn a channel on, the next one ends the cycle
+
+/* Called once all channels have been turned off again at the end of the cycle. */
+typedef void (*dimmer_done_t)(void);
+
+void dimmer_init(const PinName *pins, dimmer_done_t done);
+void dimmer_start(const byte *countdown);
+
+#endif
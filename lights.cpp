@@ -0,0 +1,8 @@
+#include "lights.h"
+
+port_t lights_port;
+
+void lights_init(void) {
+    // this claims the MASK register of port 0, nothing else uses MPIN there
+    port_init(&lights_port, LIGHTS_PORT, LIGHTS_MASK, PIN_OUTPUT);
+}
@@ -0,0 +1,38 @@
+#ifndef LIGHTS_H
+#define LIGHTS_H
+
+#include "mbed.h"
+#include "types.h"
+
+/* C0-C7 all sit on P0_16..P0_23, so every light output can be updated with a
+   single store to the masked port register (GPIO MASK/MPIN). The outputs are
+   active low, a 0 bit turns the channel on. Bit n of a port byte is P0_(16+n). */
+#define LIGHTS_PORT     Port0
+#define LIGHTS_SHIFT    16
+#define LIGHTS_MASK     (0xFF << LIGHTS_SHIFT)
+
+/* Channel bitmap (bit n = Cn) to port byte. */
+#define CHANNELS_TO_PORT(c) \
+    ((((c) & 0x01) >> 0) | (((c) & 0x04) >> 1) | (((c) & 0x10) >> 2) | (((c) & 0x40) >> 3) | \
+     (((c) & 0x02) << 3) | (((c) & 0x08) << 2) | (((c) & 0x20) << 1) | ((c) & 0x80))
+
+/* Chase pattern (bit 7 = C0 ... bit 0 = C7, the old BusOut order) to port byte. */
+#define PATTERN_TO_PORT(p) \
+    ((((p) & 0x80) >> 7) | (((p) & 0x20) >> 4) | (((p) & 0x08) >> 1) | (((p) & 0x02) << 2) | \
+     (((p) & 0x40) >> 2) | (((p) & 0x10) << 1) | (((p) & 0x04) << 4) | (((p) & 0x01) << 7))
+
+extern port_t lights_port;
+
+void lights_init(void);
+
+/* Write all eight outputs at once from a port byte. Safe from any ISR. */
+static inline void lights_write_port(byte bits) {
+    *lights_port.reg_mpin = (uint32_t)bits << LIGHTS_SHIFT;
+}
+
+/* Write all eight outputs at once from a chase pattern. */
+static inline void lights_write(byte pattern) {
+    lights_write_port(PATTERN_TO_PORT(pattern));
+}
+
+#endif
@@ -0,0 +1,67 @@
+#include "line_reader.h"
+
+void line_open(sLineReader *reader, seq_file_t *fp, char *buf, word size) {
+    reader->fp = fp;
+    reader->buf = buf;
+    reader->size = size;
+    reader->len = 0;
+    reader->pos = 0;
+}
+
+const char *line_next(sLineReader *reader, word *len) {
+    char *start;
+    char *nl;
+    word n;
+
+    while (1) {
+        start = reader->buf + reader->pos;
+        n = reader->len - reader->pos;
+        nl = (char *)memchr(start, '\n', n);
+        if (nl != NULL) {
+            *len = nl - start;
+            reader->pos += *len + 1;
+            return start;
+        }
+
+        if ((reader->pos == 0) && (reader->len == reader->size)) {
+            *len = n;                               // longer than the buffer, hand out what we have
+            reader->pos = reader->len;
+            return start;
+        }
+
+        // move the partial line to the front and fill up the rest
+        memmove(reader->buf, start, n);
+        reader->len = n;
+        reader->pos = 0;
+        n = seq_fread(reader->fp, reader->buf + reader->len, reader->size - reader->len);
+        if (n == 0) {
+            if (reader->len == 0) {
+                return NULL;
+            }
+            *len = reader->len;                     // the last line had no '\n'
+            reader->pos = reader->len;
+            return reader->buf;
+        }
+        reader->len += n;
+    }
+}
+
+byte line_uint(const char **p, const char *end, unsigned int *value) {
+    const char *s = *p;
+    unsigned int v = 0;
+
+    while ((s < end) && ((*s == ' ') || (*s == '\t'))) {
+        s++;
+    }
+    if ((s >= end) || (*s < '0') || (*s > '9')) {
+        *p = s;
+        return FALSE;
+    }
+    while ((s < end) && (*s >= '0') && (*s <= '9')) {
+        v = v * 10 + (*s - '0');
+        s++;
+    }
+    *value = v;
+    *p = s;
+    return TRUE;
+}
@@ -0,0 +1,37 @@
+#ifndef LINE_READER_H
+#define LINE_READER_H
+
+#include "mbed.h"
+#include "types.h"
+#include "seq_file.h"
+
+/* Reads a text file in large chunks into a caller supplied buffer and hands
+   out each line as a span of that buffer, so the numbers are parsed where
+   they lie instead of being copied out line by line. The file system still
+   copies each chunk into the buffer from its own sector buffer: the reads
+   start wherever the last line ended, so they are never whole aligned
+   sectors it could transfer directly. A line that straddles the end of the
+   buffer is moved to the front before the next read. Lines longer than the
+   buffer come out in buffer sized pieces. */
+
+#define LINE_BUF_SIZE   512     // one read per sector's worth of text
+
+typedef struct {
+    seq_file_t *fp;
+    char *buf;
+    word size;
+    word len;                   /* Bytes in buf. */
+    word pos;                   /* Start of the next line. */
+    } sLineReader;
+
+void line_open(sLineReader *reader, seq_file_t *fp, char *buf, word size);
+
+/* The next line without its '\n', or NULL at the end of the file. The span
+   stays valid until the next call. */
+const char *line_next(sLineReader *reader, word *len);
+
+/* Skip blanks and parse an unsigned decimal number, leaving *p after it.
+   FALSE if there is no number before end. */
+byte line_uint(const char **p, const char *end, unsigned int *value);
+
+#endif
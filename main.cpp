@@ -5,6 +5,22 @@
 #include "types.h"
 #include "sequences.h"
 #include "dim_steps.h"
+#include "dim_ramp.h"
+#include "speed_curve.h"
+#include "speed_pot.h"
+#include "sync_link.h"
+#include "dimmer.h"
+#include "lights.h"
+#include "seq_bin.h"
+#include "seq_stream.h"
+#include "seq_pack.h"
+#include "crc16.h"
+#include "line_reader.h"
+#include "seq_txt.h"
+#include "arena.h"
+#include "watermark.h"
+#include "seq_file.h"
+#include "ser_fmt.h"
 
 // #define FT_FT_DEBUG 0
 #ifdef FT_FT_DEBUG
@@ -18,47 +34,45 @@
 
 
 /* Serial debug port. */
-Serial pc(P1_13, P1_14); // tx, rx
+RawSerial pc(P1_13, P1_14); // tx, rx
+
+#ifdef FT_NO_STDIO
+/* error() and MBED_ASSERT report through mbed_error_vfprintf(), which formats
+   with vsnprintf and would bring back the stdio this build leaves out. The
+   Makefile wraps it to come here instead. pc is constructed first, so it is
+   there for an error() from the constructors below. */
+extern "C" void __wrap_mbed_error_vfprintf(const char *format, va_list args) {
+    ser_vprintf(&pc, format, args);
+}
+#endif
 
 DigitalOut Test_RXD(P1_26);
 DigitalOut Test_TXD(P1_27);
 
 InterruptIn int_ZCD(P0_2);
 Ticker tkr_Timer;
-Ticker tkr_FastInt;
 
 /* Determines the fastest and slowest sequence step timing. Times are in
     1/60th of a second (one clock).*/
-#define FASTEST_TIME 10.0
-#define SLOWEST_TIME 300.0
-/* The AnalogIn function scales the voltage input to a float 0.0-1.0. */
-#define SLOPE (SLOWEST_TIME - FASTEST_TIME)
-
-/* These coefficients are used to convert the potentiometer input to a 
-exponetial curve that mimics the desired response. */
-#define A_COEFF 0.0207
-#define B_COEFF 3.9
-#define C_COEFF -0.0207
-
-#define MAX_SLICE 250   // how many slices to allow in a half AC cycle
+#define FASTEST_TIME 10
+#define SLOWEST_TIME 300
+
+/* The potentiometer is converted to a time in clocks through speed_curve[],
+an exponetial curve that mimics the desired response. It is generated by
+speed_curve.py, which must be rerun if the times above change. */
+#define POT_RESET_CODES 102           // a speed change bigger than this restarts the current step
+
 #define HALF_CYCLE 8333     // usec for one half cycle of 60Hz power
-#define SLICE 65       // usec for slices of a half AC cycle
-#define DURATION_OF_ISR 300            // how long it takes the ZCD_SD ISR to execute
 
-/* The potentiometer input port to select the speed of the sequence steps. */
-AnalogIn potentiometer(P0_11);
+#define SEQ_LINK_MAP 16     // DWORDs for seq.bin's cluster link map, enough for 7 fragments
 
-/* Setup the output pins. */
-DigitalOut C0(P0_16);
-DigitalOut C1(P0_20);
-DigitalOut C2(P0_17);
-DigitalOut C3(P0_21);
-DigitalOut C4(P0_18);
-DigitalOut C5(P0_22);
-DigitalOut C6(P0_19);
-DigitalOut C7(P0_23);
+/* The potentiometer input port to select the speed of the sequence steps. It
+    is sampled in the background by speed_pot. */
+#define POTENTIOMETER P0_11
 
-BusOut lights(P0_23, P0_19, P0_22, P0_18, P0_21, P0_17, P0_20, P0_16);
+/* The output pins in channel order, for the dimmer. C0-C7 are written together
+    through the lights port. */
+const PinName channel_pins[8] = {P0_16, P0_20, P0_17, P0_21, P0_18, P0_22, P0_19, P0_23};
 
 /* Setup the dipswitch input port. */
 BusInOut dipswitch(P1_23, P0_12, P0_13, P0_14, P0_7, P0_8, P0_9, P1_24);
@@ -71,7 +85,6 @@ DigitalInOut reset(P0_0);
 /* Setup the SD card detect input */
 DigitalInOut sd_present(P1_15);
 
-float speed;            /* The selected speed for chases. */
 word dimmer_speed = 1;      /* The selected speed for dimming */
 int speed_clks;         /* speed in clocks (1/60th sec). */
 int clocks = 1;             /* Incremented everytime the zero cross interrupt is called. */
@@ -81,33 +94,52 @@ byte *ptrSequence;      /* A pointer to the desired sequence. */
 
 word sequenceLength;    /* The length of the desired sequence. */
 word step;              /* The step in the current sequence. */
-char line[100];
 byte master_sequence; 
 byte C = 0;
 byte R = 0;
 byte Z = 0;
 byte MASTER = 0;        // assume slave unless master is enabled
 
-float old_pot, new_pot;
+word old_pot, new_pot;  /* 10-bit potentiometer codes. */
+word pot_seen;          /* speed_pot_events() when the speed was last picked up. */
 
-sDimStep *ptrDimSequence;
-sDimStep *ptrDimSeq = NULL;
+const byte *ptrDimSequence;     /* Packed steps, see seq_pack.h. */
+const byte *ptrDimSeq = NULL;
 unsigned int DimSeqLen;
+word DimSeqKept;                /* Steps packed so far while the sequence loads. */
+sDimStep DimKeptLast;           /* The last of them, which the next one is packed against. */
+sSeqPackCursor DimCursor;       /* The step the crossing ISR is on. */
+
+byte DimSeqStreamed = FALSE;    /* The sequence plays straight off the SD card rather than from RAM. */
+DWORD SeqLinkMap[SEQ_LINK_MAP]; /* seq.bin's cluster chain, so seeking into it costs no FAT reads. */
+
+byte TxtSequence;               /* The sequence we play, while seq.txt is parsed. */
+byte TxtPass;                   /* Which pass of the bulk transfer this parse is. */
+byte TxtKeep = FALSE;           /* The sequence being parsed is ours, pack it into the arena. */
+byte TxtFound;                  /* Our sequence has come up in seq.txt. */
 
 byte ticks = 1;
-byte zc_slice = 0;
 
 /* The dimmer timers for each channel. */
 byte Dimmer[8] = {0, 0, 0, 0, 0, 0, 0, 0};
 
 void master_timer_isr (void);
 void slave_timer_isr(void);
-void slice_timer_isr(void);
+void dimmer_done_isr(void);
 void master_zcross_isr(void);
 void slave_zcross_isr(void);
 void vfnLoadSequencesFromSD(byte);
-void vfnGetLine(void);
+byte vfnLoadSequencesFromBin(seq_file_t *, byte);
 void vfnSlaveReceiveData(byte);
+const sDimStep *ptrGetDimStep(word);
+void vfnKeepStart(word);
+void vfnKeepStep(const sDimStep *);
+void vfnKeepFinish(void);
+void vfnTxtStart(unsigned int, unsigned int);
+void vfnTxtStep(const sDimStep *);
+void vfnTxtFinish(void);
+void vfnReportSDInit(SDFileSystem &);
+void vfnServiceWatermark(void);
 
 
 void master_timer_isr(void) {
@@ -125,7 +157,7 @@ void master_timer_isr(void) {
             Z = 1;
         }
         pattern = ~ptrSequence[step];
-        lights = pattern;  
+        lights_write(pattern);  
     }
 }
 
@@ -133,6 +165,17 @@ void slave_timer_isr(void) {
     // as a slave running a chase sequence from internal flash, execute these sync instructions every time the step timer expires
     // to make steps longer in this mode, simply add duplicate channel bitmaps.  tick means nothing here.
     // R = restart, Z = step to next
+    sSyncCmd cmd;
+    
+    while (sync_get(&cmd)) {                       // pick up the commands the master sent since the last time
+        if (cmd.op == SYNC_RESTART) {
+            R = 1;
+        }
+        else if (cmd.op == SYNC_STEP) {
+            Z = 1;
+        }
+    }
+    
     if (R) {
         step = 0;
     }
@@ -142,45 +185,26 @@ void slave_timer_isr(void) {
     
     if ((R == 1) or (Z == 1)) {
         pattern = ~ptrSequence[step];
-        lights = pattern;
+        lights_write(pattern);
 
         R = 0;
         Z = 0;      
     }
 }
 
-void slice_timer_isr(void) {
-    // while in dimmer mode, execute this routine every delta-T slice to evaluate whether to active a channel
-
-    if (zc_slice > 240) {                              // if nearing the end of a full AC cycle, reset everything for the next cycle
-        lights = 0xFF;                                 // C0-C7 all off (but they'll stay on until the ZC occurs)
-        zc_slice = 0;                                  // clear the slice counter for the next half cycle
-        tkr_FastInt.detach();                          // disable this timer interrupt
-        
-        if (MASTER) {
-            int_ZCD.fall(&master_zcross_isr);      // enable the zero crossing interrupt since we're done dimming for this half cycle
-        } 
-        else {
-            int_ZCD.fall(&slave_zcross_isr);
-        }
-        return;
+void dimmer_done_isr(void) {
+    // the dimmer has turned C0-C7 off near the end of a full AC cycle, get ready for the next cycle
+    if (MASTER) {
+        int_ZCD.fall(&master_zcross_isr);          // enable the zero crossing interrupt since we're done dimming for this half cycle
+    } 
+    else {
+        int_ZCD.fall(&slave_zcross_isr);
     }
-    
-    zc_slice++;
-    
-    if (Dimmer[0] != 0) Dimmer[0]--; else C0 = 0;
-    if (Dimmer[1] != 0) Dimmer[1]--; else C1 = 0;
-    if (Dimmer[2] != 0) Dimmer[2]--; else C2 = 0;
-    if (Dimmer[3] != 0) Dimmer[3]--; else C3 = 0;
-    if (Dimmer[4] != 0) Dimmer[4]--; else C4 = 0;
-    if (Dimmer[5] != 0) Dimmer[5]--; else C5 = 0;
-    if (Dimmer[6] != 0) Dimmer[6]--; else C6 = 0;
-    if (Dimmer[7] != 0) Dimmer[7]--; else C7 = 0;    
 }
 
 void master_zcross_isr(void) {
     // as the master running a dimmer sequence loaded from the SD card, execute this every time a rising AC zero crossing occurs.
-    int i;
+    const sDimStep *ptrStep;
     
     if (int_ZCD.read() == 0) {                     // the AC line just crossed to positive
         int_ZCD.fall(NULL);                        // disable the ZCD interrupt otherwise it will trigger on the negative edge also due to some bug. noise?
@@ -199,27 +223,48 @@ void master_zcross_isr(void) {
             Z = 1;
         }    
 
-        total_clocks_per_step = dimmer_speed * ptrDimSequence[step].ticks;
-        clocks = total_clocks_per_step;
+        ptrStep = ptrGetDimStep(step);
+        if (ptrStep == NULL) {                     // the card hasn't caught up, hold this level and look again next crossing
+            step = (step == 0) ? sequenceLength - 1 : step - 1;
+            clocks = 1;
+            R = 0;
+            Z = 0;
+        }
+        else {
+            total_clocks_per_step = dimmer_speed * ptrStep->ticks;
+            clocks = total_clocks_per_step;
+            ramp_begin(ptrStep, total_clocks_per_step);
+        }
+    }
+    else {
+        ramp_advance();
     }
         
-    for(i=0; i<8; i++) {
-        Dimmer[i] = 255 - (ptrDimSequence[step].Chan[i].start + ((ptrDimSequence[step].Chan[i].stop - ptrDimSequence[step].Chan[i].start) * clocks) / total_clocks_per_step);
-    }   
+    ramp_countdowns(Dimmer);
     
-    /* Timer for the 255 step dimmer routine. */
-    zc_slice = 0;
-    tkr_FastInt.attach_us(&slice_timer_isr, SLICE);
+    /* Schedule the channel firings for the 255 step dimmer routine. */
+    dimmer_start(Dimmer);
 }
 
 void slave_zcross_isr(void) {
     // as a slave running a dimmer sequence receieved from the master, execute these sync instructions every time a rising AC zero crossing occurs
-    int i;
+    sSyncCmd cmd;
+    const sDimStep *ptrStep;
     
     if (int_ZCD.read() == 0) {                     // the AC line just crossed to positive
         int_ZCD.fall(NULL);                        // disable the ZCD interrupt otherwise it will trigger on the negative edge also due to some bug. noise?
     }
 
+    while (sync_get(&cmd)) {                       // pick up the commands the master sent since the last crossing
+        if (cmd.op == SYNC_RESTART) {
+            R = 1;
+        }
+        else if (cmd.op == SYNC_STEP) {
+            Z = 1;
+        }
+        dimmer_speed = cmd.speed;                  // so we dim at the same rate as the master
+    }
+
     if (R) {
         step = 0;
     }
@@ -228,150 +273,307 @@ void slave_zcross_isr(void) {
     }
     
     if (R or Z) {
-        total_clocks_per_step = dimmer_speed * ptrDimSequence[step].ticks;
-        clocks = total_clocks_per_step;
+        ptrStep = ptrGetDimStep(step);
+        if (ptrStep != NULL) {                     // NULL if the master runs past the end of ours
+            total_clocks_per_step = dimmer_speed * ptrStep->ticks;
+            clocks = total_clocks_per_step;
+            ramp_begin(ptrStep, total_clocks_per_step);
+        }
         R = 0;
         Z = 0;
     }
     
     if (clocks > 0) {
         clocks--;
-    
-        for(i=0; i<8; i++) {
-            Dimmer[i] = 255 - (ptrDimSequence[step].Chan[i].start + ((ptrDimSequence[step].Chan[i].stop - ptrDimSequence[step].Chan[i].start) * clocks) / total_clocks_per_step);
-        }   
+        ramp_advance();
+        ramp_countdowns(Dimmer);
+    }
+    /* Schedule the channel firings for the 255 step dimmer routine. */
+    dimmer_start(Dimmer);
+}
+
+const sDimStep *ptrGetDimStep(word step) {
+    // the master's dimming step, from RAM or from the streaming buffers
+    if (DimSeqStreamed) {
+        return seq_stream_step(step);
+    }
+    if (ptrDimSequence == NULL) {
+        return NULL;
+    }
+    return seq_pack_step(&DimCursor, step);     // decodes the next step, the current one is kept
+}
+
+void vfnKeepStart(word steps) {
+    // start packing a sequence of steps into the arena, replacing whatever was there
+    arena_reset();
+    ptrDimSeq = (const byte *) arena_extend(0);
+    DimSeqLen = steps;
+    DimSeqKept = 0;
+}
+
+void vfnKeepStep(const sDimStep *ptrStep) {
+    // pack one more step onto the end, dropping the sequence once the arena is full
+    const sDimStep *prev;
+    byte *dst;
+
+    if ((ptrDimSeq == NULL) || (DimSeqKept >= DimSeqLen)) {
+        return;
+    }
+    prev = (DimSeqKept > 0) ? &DimKeptLast : NULL;
+    dst = (byte *) arena_extend(seq_pack_size(ptrStep, prev));
+    if (dst == NULL) {
+        ptrDimSeq = NULL;
+        DimSeqLen = 0;
+        return;
+    }
+    seq_pack(dst, ptrStep, prev);
+    DimKeptLast = *ptrStep;
+    DimSeqKept++;
+}
+
+void vfnKeepFinish(void) {
+    // the steps that were announced but never came hold the last level for a tick each
+    sDimStep pad;
+
+    dim_step_hold(&pad, (DimSeqKept > 0) ? &DimKeptLast : NULL);
+    while ((ptrDimSeq != NULL) && (DimSeqKept < DimSeqLen)) {
+        vfnKeepStep(&pad);
+    }
+}
+
+void vfnTxtStart(unsigned int sequence_num, unsigned int steps) {
+    // a Q line: transmit to the slaves as the steps are parsed, and keep our own
+    sync_bulk_start(sequence_num, steps);
+    TxtKeep = (TxtPass == 0) && (sequence_num == TxtSequence);     // the first copy is ours, later passes are for the slaves
+    if (TxtKeep) {
+        vfnKeepStart(steps);                // a repeated Q line replaces the earlier copy
+        TxtFound = TRUE;
     }
-    /* Timer for the 255 step dimmer routine. */
-    zc_slice = 0;
-    tkr_FastInt.attach_us(&slice_timer_isr, SLICE);
+}
+
+void vfnTxtStep(const sDimStep *ptrStep) {
+    // only keep the steps the Q line announced so the buffer can't overrun
+    if (sync_bulk_step(ptrStep) && TxtKeep) {
+        vfnKeepStep(ptrStep);
+    }
+}
+
+void vfnTxtFinish(void) {
+    sync_bulk_finish();
+    if (TxtKeep) {
+        vfnKeepFinish();
+    }
+    TxtKeep = FALSE;
 }
 
 void vfnLoadSequencesFromSD(byte sequence) {
 
-    FILE *fp;
-    int steps;
-    sDimStep *ptr = NULL;
-    SDFileSystem sd(P1_22, P1_21, P1_20, P1_19, "sd"); // the pinout on the FT33 controller
-    unsigned int ticks;
-    unsigned int ChanStart[8];
-    unsigned int ChanStop[8];
-    unsigned int i;
-    unsigned int sequence_num;
+    static const sSeqTxtSink txt_sink = { vfnTxtStart, vfnTxtStep, vfnTxtFinish };
+    seq_file_t *fp;
+    static SDFileSystem sd(P1_22, P1_21, P1_20, P1_19, "sd"); // the pinout on the FT33 controller, kept mounted for streaming
+    char *text;
     
-    fp = fopen("/sd/seq.txt", "r");
+    // bring the card up once, every phase has a deadline, and say how it went
+    if (sd.mount() != 0) {
+        vfnReportSDInit(sd);
+        return;
+    }
+    vfnReportSDInit(sd);
+
+    // use the indexed seq.bin when there is one, seq.txt otherwise
+    fp = seq_fopen(&sd, "seq.bin", SeqLinkMap, SEQ_LINK_MAP);
+    if (fp != NULL) {
+        if (vfnLoadSequencesFromBin(fp, sequence)) {
+            return;         // closed there unless the sequence streams from it
+        }
+        seq_fclose(fp);
+    }
+
+    fp = seq_fopen(&sd, "seq.txt", NULL, 0);
+    text = (char *) arena_borrow(LINE_BUF_SIZE);   // only needed while parsing, so it comes off the top of the arena
     if(fp == NULL) {
-        // if the SD card is present but not responding, reset and try again
-        NVIC_SystemReset();
+        ser_printf(&pc, "SD: no seq.bin or seq.txt\r\n");
+    }
+    else if (text == NULL) {
+        ser_printf(&pc, "SD: no room to parse seq.txt\r\n");
+        seq_fclose(fp);
     }
     else {
-        pc.printf("\n");    // in case the "No SD card found" message is sent, be sure to start with a fresh line buffer
-        while(fgets(line, 100, fp) != NULL) {
-            pc.printf(line);        // transmit to the slaves
-            
-            if(line[0] == 'Q') {
-                sscanf(line, "%*s %d %d", &sequence_num, &steps);
-                if(sequence_num == sequence) {
-                    ptr = (sDimStep *) malloc(sizeof(sDimStep) * steps);
-                    if (ptr == NULL) {
-                        break;
-                    }
-                    ptrDimSeq = ptr;
-                    DimSeqLen = steps;
-                }
+        // send everything again for as long as some slave missed its sequence
+        TxtSequence = sequence;
+        TxtFound = FALSE;
+        for (TxtPass = 0; TxtPass < SYNC_BULK_PASSES; TxtPass++) {
+            seq_txt_parse(fp, text, &txt_sink);
+            if (!sync_bulk_end(TxtPass + 1 == SYNC_BULK_PASSES)) {
+                break;
             }
-            else if(line[0] == 'S') {
-                if(sequence_num == sequence) {
-                    sscanf(line, "%*s %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u",
-                            &ticks,
-                            &ChanStart[0], &ChanStop[0],
-                            &ChanStart[1], &ChanStop[1],
-                            &ChanStart[2], &ChanStop[2],
-                            &ChanStart[3], &ChanStop[3],
-                            &ChanStart[4], &ChanStop[4],
-                            &ChanStart[5], &ChanStop[5],
-                            &ChanStart[6], &ChanStop[6],
-                            &ChanStart[7], &ChanStop[7]);
-
-                    ptr->ticks = (unsigned char)(ticks & 0x000000FF);
-                
-                    for (i = 0; i < 8; i++) {
-                        ptr->Chan[i].start = (unsigned char)(ChanStart[i] & 0x000000FF);
-                        ptr->Chan[i].stop  = (unsigned char)(ChanStop[i]  & 0x000000FF);
-                    }
-                    ptr++;
-                }
-            }  
         }
-        fclose(fp);
+        seq_fclose(fp);
+
+        if (TxtFound && (ptrDimSeq == NULL)) {
+            ser_printf(&pc, "Sequence %u doesn't fit in %u bytes\r\n", sequence, arena_size() - LINE_BUF_SIZE);
+        }
     }
+    arena_return();
 }
 
-void vfnGetLine(void) {
-    
-    int num = 0;
-    char c;
+void vfnReportSDInit(SDFileSystem &sd) {
+    // one line over the serial port: result code, then the time of each phase in usec
+    const sd_init_report_t &report = sd.init_report();
+
+    ser_printf(&pc, "SD %d: CMD0 %lu CMD8 %lu ACMD41 %lu CSD %lu mount %lu us\r\n",
+            report.result,
+            (unsigned long)report.us[SD_PHASE_CMD0],
+            (unsigned long)report.us[SD_PHASE_CMD8],
+            (unsigned long)report.us[SD_PHASE_ACMD41],
+            (unsigned long)report.us[SD_PHASE_CSD],
+            (unsigned long)report.us[SD_PHASE_MOUNT]);
+}
 
-    while(((c = pc.getc()) != '\n') && num < 98) {
-        line[num] = c;
-        num++;
+void vfnServiceWatermark(void) {
+    // keep the stack and heap peaks up to date, and report them when a W comes in over the serial port
+    sWatermark marks;
+
+    watermark_service();
+    if (pc.readable() && (pc.getc() == 'W')) {
+        watermark_get(&marks);
+        ser_printf(&pc, "Stack %u of %u, heap %u of %u, arena %u of %u bytes\r\n",
+                marks.stack_peak, marks.stack_size,
+                marks.heap_peak, marks.heap_size,
+                arena_high_water(), arena_size());
     }
-    line[num] = 0x00;
 }
 
-void vfnSlaveReceiveData(byte sequence) {
+byte vfnLoadSequencesFromBin(seq_file_t *fp, byte sequence) {
+
+    sSeqBinEntry entry;
+    sSeqBinEntry stream_entry;
+    sDimStep dim_step;
+    sDimStep *ptr;
+    const byte *data;
+    byte count;
+    byte i;
+    byte keep;
+    byte stream = FALSE;
+    byte pass;
+    word step;
+    word crc;
+    word n;
+
+    count = seq_bin_open(fp);
+    if (count == 0) {
+        return FALSE;
+    }
+
+    // send everything again for as long as some slave missed its sequence
+    for (pass = 0; pass < SYNC_BULK_PASSES; pass++) {
+        for (i = 0; i < count; i++) {
+            if (!seq_bin_entry(fp, i, &entry)) {
+                break;
+            }
 
-    int steps;
-    int step;
-    sDimStep *ptr = NULL;
-    unsigned int ticks;
-    unsigned int ChanStart[8];
-    unsigned int ChanStop[8];
-    unsigned int i;
-    unsigned int sequence_num;
+            keep = (pass == 0) && (entry.sequence == sequence);    // the first copy is ours, later passes are for the slaves
+            if (keep) {
+                vfnKeepStart(entry.steps);
+            }
 
-    while(1) {
-        vfnGetLine();
-        
-        if(line[0] == 'Q') {
-            sscanf(line, "%*s %d %d", &sequence_num, &steps);
-            if(sequence_num == sequence) {
-                ptr = (sDimStep *) malloc(sizeof(sDimStep) * steps);
-                if (ptr == NULL) {
+            // transmit to the slaves, the records go out as they are stored and ours is packed on the way past
+            crc = 0xFFFF;
+            sync_bulk_start(entry.sequence, entry.steps);
+            seq_fseek(fp, entry.offset);
+            for (step = 0; step < entry.steps; step++) {
+                if (seq_fread(fp, &dim_step, sizeof(sDimStep)) != sizeof(sDimStep)) {
                     break;
                 }
-                ptrDimSeq = ptr;
-                DimSeqLen = steps;
-                step = 0;
+                sync_bulk_step(&dim_step);
+                if (keep) {
+                    data = (const byte *)&dim_step;
+                    for (n = 0; n < sizeof(sDimStep); n++) {
+                        crc = crc16(crc, *data++);
+                    }
+                    vfnKeepStep(&dim_step);
+                }
             }
-        }
-        else if(line[0] == 'S') {
-            if(sequence_num == sequence) {
-                sscanf(line, "%*s %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u",
-                        &ticks,
-                        &ChanStart[0], &ChanStop[0],
-                        &ChanStart[1], &ChanStop[1],
-                        &ChanStart[2], &ChanStop[2],
-                        &ChanStart[3], &ChanStop[3],
-                        &ChanStart[4], &ChanStop[4],
-                        &ChanStart[5], &ChanStop[5],
-                        &ChanStart[6], &ChanStop[6],
-                        &ChanStart[7], &ChanStop[7]);
-
-                ptr->ticks = (unsigned char)(ticks & 0x000000FF);
-            
-                for (i = 0; i < 8; i++) {
-                    ptr->Chan[i].start = (unsigned char)(ChanStart[i] & 0x000000FF);
-                    ptr->Chan[i].stop  = (unsigned char)(ChanStop[i]  & 0x000000FF);
+            sync_bulk_finish();
+
+            if (keep) {
+                if ((step < entry.steps) || (crc != entry.crc)) {   // unreadable or damaged, play nothing
+                    ptrDimSeq = NULL;
+                    DimSeqLen = 0;
                 }
-                
-                ptr++;                
-                step++;
-                
-                if (step >= steps) {
-                    break;
+                else if (ptrDimSeq == NULL) {                       // too long even packed, play it off the card
+                    stream_entry = entry;
+                    stream = TRUE;
                 }
             }
-        }              
+        }
+        if (!sync_bulk_end(pass + 1 == SYNC_BULK_PASSES)) {
+            break;
+        }
+    }
+
+    if (stream) {
+        arena_reset();
+        ptr = (sDimStep *) arena_alloc(STREAM_BUF_BYTES);
+        if ((ptr != NULL) && seq_stream_open(fp, &stream_entry, ptr)) {
+            DimSeqLen = stream_entry.steps;
+            DimSeqStreamed = TRUE;
+        }
+    }
+
+    if (!DimSeqStreamed) {
+        seq_fclose(fp);
+    }
+    return TRUE;
+}
+
+void vfnSlaveReceiveData(byte sequence) {
+
+    word steps;
+    word i;
+    sDimStep dim_step;
+    byte sequence_num;
+    byte kept = FALSE;
+    byte heard = FALSE;
+
+    // keep the first good copy, and skip the rest of the transfer so it doesn't reach the frame decoder
+    while(1) {
+        switch (sync_bulk_header(&sequence_num, &steps)) {
+        case BULK_BLOCK:
+            heard = TRUE;
+            if (kept || (sequence_num != sequence)) {
+                sync_bulk_read(NULL, steps);
+                sync_bulk_check();
+                break;
+            }
+            vfnKeepStart(steps);
+            for (i = 0; i < steps; i++) {   // packed as it arrives, dropped if too long for this slave
+                sync_bulk_read(&dim_step, 1);
+                vfnKeepStep(&dim_step);
+            }
+            kept = sync_bulk_check();
+            if (!kept) {
+                ptrDimSeq = NULL;           // garbled, play nothing unless a later pass brings it
+                DimSeqLen = 0;
+            }
+            break;
+
+        case BULK_END_PASS:
+            heard = TRUE;
+            if (!kept) {
+                sync_bulk_nak();
+            }
+            break;
+
+        case BULK_END_CLOSE:
+            return;
+
+        case BULK_TIMEOUT:
+            if (heard) {
+                return;                     // the master went quiet part way through
+            }
+            break;                          // it hasn't started yet
+        }
     }
 }
 
@@ -379,20 +581,14 @@ int main() {
 
     byte sequence;
     byte sd;
-    byte command_char;
-
-    // Initialize the unused RAM to track heap usage
-    for (uint32_t i = 0x10001200; i < 0x10002000; i++) {
-        *(volatile uint8_t *)i = 0xCD;
-    }
 
-    // Initialize the unused USB RAM to track stack usage
-    for (uint32_t i = 0x20004000; i < 0x20004700; i++) {
-        *(volatile uint8_t *)i = 0xCD;
-    }
+    // Paint the free heap and stack so their peak use can be read back later
+    watermark_init();
 
     /* Basic initialization. */
-    lights = 0xFF; /* all off */
+    lights_init();
+    sync_init(&pc);
+    lights_write(0xFF); /* all off */
     
     speed_clks = FASTEST_TIME;
     
@@ -422,9 +618,10 @@ int main() {
 #endif
     
     if (!test) {
+        speed_pot_init(POTENTIOMETER);
         while (1) {
             wait(0.1);
-            lights = potentiometer.read_u16() >> 8;
+            lights_write(speed_pot_read() >> 2);
         }
     }
     
@@ -436,7 +633,17 @@ int main() {
     
     wait(1.0);
 
+    /* Bring the link to the slaves up to the fastest rate they can all follow. */
+    if (MASTER) {
+        sync_negotiate_master();
+    }
+    else {
+        sync_negotiate_slave();
+    }
+
     if (MASTER) {
+        speed_pot_init(POTENTIOMETER);
+        
         if(sequence < 240) {
             ptrSequence = (byte *) ptrSequences[sequence];
             sequenceLength = sequenceLengths[sequence];
@@ -446,17 +653,18 @@ int main() {
             
             /******************************************************** MASTER CHASE LOOP ********************************************************/
             while(1) {
+                vfnServiceWatermark();
                 if (R) {
-                    pc.putc('R');
+                    sync_send(SYNC_RESTART, step, speed_clks);
                     R = 0;
                 }
                 else if(Z) {
-                    pc.putc('Z');
+                    sync_send(SYNC_STEP, step, speed_clks);
                     Z = 0;
 
-                    speed = A_COEFF * exp(B_COEFF * (1.0 - potentiometer)) + C_COEFF;       // read the potentiometer
+                    new_pot = speed_pot_read();                         // read the potentiometer
                     __disable_irq();    // Disable Interrupts
-                    speed_clks = SLOPE * speed + FASTEST_TIME;      // convert the analog speed voltage to a time in clocks
+                    speed_clks = speed_curve[new_pot];                  // convert the analog speed voltage to a time in clocks
                     __enable_irq();     // Enable Interrupts 
                 }
             }
@@ -465,36 +673,59 @@ int main() {
         else {
             if (sd) {
                 vfnLoadSequencesFromSD(sequence);
+                ser_printf(&pc, "Arena %u of %u bytes\r\n", arena_high_water(), arena_size());
             }
             
             ptrDimSequence = ptrDimSeq;
             sequenceLength = DimSeqLen;
+            if (ptrDimSequence != NULL) {
+                seq_pack_open(&DimCursor, ptrDimSequence, sequenceLength);
+            }
             
             clocks = dimmer_speed;
-            new_pot = potentiometer;
+            total_clocks_per_step = clocks;
+            if (ptrGetDimStep(step) != NULL) {
+                ramp_begin(ptrGetDimStep(step), total_clocks_per_step);
+            }
+            pot_seen = speed_pot_events();
+            new_pot = speed_pot_read();
             old_pot = new_pot;
+            dimmer_speed = speed_curve[new_pot];
+
+            dimmer_init(channel_pins, &dimmer_done_isr);
 
             int_ZCD.fall(&master_zcross_isr);
             
             /******************************************************** MASTER DIMMER LOOP ********************************************************/
             while(1) {
+                vfnServiceWatermark();
+                if (DimSeqStreamed) {
+                    seq_stream_service();                       // refill the step buffer the ISR has moved off
+                }
 //                Test_RXD = 1;
-                new_pot = potentiometer;
-                if (fabs(old_pot - new_pot) > 0.1) {
-                    old_pot = new_pot;
-                    total_clocks_per_step = dimmer_speed * ptrDimSequence[step].ticks;
-                    clocks = total_clocks_per_step;
+                if (speed_pot_events() != pot_seen) {         // only when the filtered speed has really changed
+                    pot_seen = speed_pot_events();
+                    new_pot = speed_pot_read();
+                    if (abs((int)old_pot - (int)new_pot) > POT_RESET_CODES) {
+                        old_pot = new_pot;
+                        __disable_irq();    // Disable Interrupts
+                        if (ptrGetDimStep(step) != NULL) {
+                            total_clocks_per_step = dimmer_speed * ptrGetDimStep(step)->ticks;
+                            clocks = total_clocks_per_step;
+                            ramp_begin(ptrGetDimStep(step), total_clocks_per_step);
+                        }
+                        __enable_irq();     // Enable Interrupts 
+                    }
+                    dimmer_speed = speed_curve[new_pot];
                 }
-                dimmer_speed = FASTEST_TIME + (SLOPE * (A_COEFF * exp(B_COEFF * (1.0 - new_pot)) + C_COEFF));
 //                Test_RXD = 0;
                 if (R) {
-                    pc.printf("R\n");
+                    sync_send(SYNC_RESTART, step, dimmer_speed);       // with the new speed so the slaves can dim at the correct rate
                 }
                 else if(Z) {
-                    pc.printf("Z\n");
+                    sync_send(SYNC_STEP, step, dimmer_speed);
                 }
                 if (R or Z) {
-                    pc.printf("C %i\n", dimmer_speed);                // send the new speed to the slaves so they can dim at the correct rate
                     R = 0;
                     Z = 0;
                 }
@@ -512,14 +743,11 @@ int main() {
             clocks = SLOWEST_TIME;
 
             /******************************************************** SLAVE CHASE LOOP ********************************************************/
+            sync_listen();
+            
             while(1) {
-                command_char = pc.getc();
-                if (command_char == 'R') {
-                    R = 1;
-                }
-                else if (command_char == 'Z') {
-                    Z = 1;
-                }
+                // the master's commands are decoded in the receive interrupt and picked up by slave_timer_isr
+                watermark_service();                // the serial port is the master's, so only mbed_stats sees these
             }
             /***************************************************** END SLAVE CHASE LOOP ********************************************************/
         }
@@ -528,24 +756,25 @@ int main() {
             
             ptrDimSequence = ptrDimSeq;
             sequenceLength = DimSeqLen;
+            if (ptrDimSequence == NULL) {
+                while(1);                               // our sequence didn't fit, leave the lights off
+            }
+            seq_pack_open(&DimCursor, ptrDimSequence, sequenceLength);
             
             clocks = dimmer_speed;
+            total_clocks_per_step = clocks;
+            if (ptrGetDimStep(step) != NULL) {
+                ramp_begin(ptrGetDimStep(step), total_clocks_per_step);
+            }
 
+            dimmer_init(channel_pins, &dimmer_done_isr);
+            sync_listen();
             int_ZCD.fall(&slave_zcross_isr);
             
             /********************************************************* SLAVE DIMMER LOOP ********************************************************/
             while(1) {
-                vfnGetLine();
-                
-                if(line[0] == 'R') {
-                    R = 1;
-                }
-                else if (line[0] == 'Z') {
-                    Z = 1;
-                }
-                else if (line[0] == 'C') {
-                    sscanf(line, "%*s %i", &dimmer_speed);
-                }
+                // the master's commands are decoded in the receive interrupt and picked up by slave_zcross_isr
+                watermark_service();                // the serial port is the master's, so only mbed_stats sees these
             }
             /***************************************************** END SLAVE DIMMER LOOP ********************************************************/
         }
@@ -2,6 +2,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include "mbed_assert.h"
+#include "mbed_toolchain.h"
 
 #if MBED_CONF_RTOS_PRESENT
 #include "cmsis_os2.h"
@@ -9,6 +10,15 @@
 
 // note: mbed_stats_heap_get defined in mbed_alloc_wrappers.cpp
 
+#if MBED_STACK_STATS_ENABLED && !MBED_CONF_RTOS_PRESENT
+// Without the RTOS there is only the main stack, and only the application
+// knows how it is measured (painting it, for instance). It fills in
+// max_size and reserved_size.
+MBED_WEAK void mbed_stats_main_stack_get(mbed_stats_stack_t *stats)
+{
+}
+#endif
+
 void mbed_stats_stack_get(mbed_stats_stack_t *stats)
 {
     memset(stats, 0, sizeof(mbed_stats_stack_t));
@@ -33,6 +43,9 @@ void mbed_stats_stack_get(mbed_stats_stack_t *stats)
     osKernelUnlock();
 
     free(threads);
+#elif MBED_STACK_STATS_ENABLED
+    mbed_stats_main_stack_get(stats);
+    stats->stack_cnt = 1;
 #endif
 }
 
@@ -60,11 +73,13 @@ size_t mbed_stats_stack_get_each(mbed_stats_stack_t *stats, size_t count)
     osKernelUnlock();
 
     free(threads);
+#elif MBED_STACK_STATS_ENABLED
+    if (count > 0) {
+        mbed_stats_main_stack_get(stats);
+        stats->stack_cnt = 1;
+        i = 1;
+    }
 #endif
 
     return i;
 }
-
-#if MBED_STACK_STATS_ENABLED && !MBED_CONF_RTOS_PRESENT
-#warning Stack statistics are currently not supported without the rtos.
-#endif
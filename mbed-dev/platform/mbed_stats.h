@@ -76,6 +76,14 @@ void mbed_stats_stack_get(mbed_stats_stack_t *stats);
  */
 size_t mbed_stats_stack_get_each(mbed_stats_stack_t *stats, size_t count);
 
+/**
+ *  Without the RTOS, fill in max_size and reserved_size of the main stack.
+ *  Weak, does nothing unless the application provides it.
+ *
+ *  @param stats    A pointer to the zeroed mbed_stats_stack_t structure to fill
+ */
+void mbed_stats_main_stack_get(mbed_stats_stack_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -40,4 +40,7 @@ extern const PinMap PinMap_SPI_SSEL[];
 /************PWM***************/
 extern const PinMap PinMap_PWM[];
 
+/************GATE**************/
+extern const PinMap PinMap_GATE[];
+
 #endif
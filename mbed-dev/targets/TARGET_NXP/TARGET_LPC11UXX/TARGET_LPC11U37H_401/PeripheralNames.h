@@ -60,6 +60,20 @@ typedef enum {
     PWM_11
 } PWMName;
 
+/* Timer match outputs usable as triac gates: (timer << 2) | match register.
+ * CT32B1 is the us_ticker and is deliberately left out. */
+typedef enum {
+    GATE_CT16B0_MR0 = (0 << 2) | 0,
+    GATE_CT16B0_MR1 = (0 << 2) | 1,
+    GATE_CT16B0_MR2 = (0 << 2) | 2,
+    GATE_CT16B1_MR0 = (1 << 2) | 0,
+    GATE_CT16B1_MR1 = (1 << 2) | 1,
+    GATE_CT32B0_MR0 = (2 << 2) | 0,
+    GATE_CT32B0_MR1 = (2 << 2) | 1,
+    GATE_CT32B0_MR2 = (2 << 2) | 2,
+    GATE_CT32B0_MR3 = (2 << 2) | 3
+} GateName;
+
 #define STDIO_UART_TX     UART_TX
 #define STDIO_UART_RX     UART_RX
 #define STDIO_UART        UART_0
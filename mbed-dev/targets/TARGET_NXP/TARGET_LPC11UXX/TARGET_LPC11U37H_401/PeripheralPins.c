@@ -115,3 +115,24 @@ const PinMap PinMap_PWM[] = {
 
     {NC, NC, 0}
 };
+
+/************GATE**************/
+/* Match outputs that can drive a triac gate from a timer compare. */
+const PinMap PinMap_GATE[] = {
+    /* CT16B0 */
+    {P0_8 , GATE_CT16B0_MR0, 2}, {P1_13, GATE_CT16B0_MR0, 2},
+    {P0_9 , GATE_CT16B0_MR1, 2}, {P1_14, GATE_CT16B0_MR1, 2},
+    {P0_10, GATE_CT16B0_MR2, 3}, {P1_15, GATE_CT16B0_MR2, 2},
+
+    /* CT16B1 */
+    {P0_21, GATE_CT16B1_MR0, 1},
+    {P0_22, GATE_CT16B1_MR1, 2}, {P1_23, GATE_CT16B1_MR1, 1},
+
+    /* CT32B0 */
+    {P0_18, GATE_CT32B0_MR0, 2}, {P1_24, GATE_CT32B0_MR0, 1},
+    {P0_19, GATE_CT32B0_MR1, 2}, {P1_25, GATE_CT32B0_MR1, 1},
+    {P0_1 , GATE_CT32B0_MR2, 2}, {P1_26, GATE_CT32B0_MR2, 1},
+    {P0_11, GATE_CT32B0_MR3, 3}, {P1_27, GATE_CT32B0_MR3, 1},
+
+    {NC, NC, 0}
+};
@@ -0,0 +1,86 @@
+#include "gate_api.h"
+#include "cmsis.h"
+#include "pinmap.h"
+#include "PeripheralPins.h"
+
+#define TCR_CNT_EN       0x00000001
+#define TCR_RESET        0x00000002
+
+#define EMC_NOTHING      0x0
+#define EMC_CLEAR        0x1
+
+static LPC_CTxxBx_Type *Timers[3] = {
+    LPC_CT16B0, LPC_CT16B1,
+    LPC_CT32B0
+};
+
+static uint8_t timers_used = 0;
+
+int gate_init(gate_t *obj, PinName pin) {
+    GateName gate = (GateName)pinmap_peripheral(pin, PinMap_GATE);
+    if (gate == (GateName)NC) {
+        return 0;
+    }
+
+    uint8_t tid = gate >> 2;
+    LPC_CTxxBx_Type *timer = Timers[tid];
+
+    obj->timer = timer;
+    obj->mr = gate & 0x3;
+
+    if (!(timers_used & (1 << tid))) {
+        timers_used |= 1 << tid;
+
+        // Power the timer and run it at 1MHz, free running with no interrupts
+        LPC_SYSCON->SYSAHBCLKCTRL |= 1 << (tid + 7);
+        timer->TCR = TCR_RESET;
+        timer->PR = SystemCoreClock / 1000000 - 1;
+        timer->MCR = 0;
+        timer->PWMC = 0;
+        timer->EMR = 0;
+        timer->TCR = TCR_CNT_EN;
+    }
+
+    gate_off(obj);
+
+    // Wire pinout
+    pinmap_pinout(pin, PinMap_GATE);
+    return 1;
+}
+
+void gate_arm(gate_t *obj, uint32_t us) {
+    LPC_CTxxBx_Type *timer = obj->timer;
+
+    timer->MR[obj->mr] = us;
+    timer->EMR = (timer->EMR & ~(0x3 << (4 + 2 * obj->mr)))
+               | (1 << obj->mr)                           // off until the match
+               | (EMC_CLEAR << (4 + 2 * obj->mr));        // then pull the gate low
+}
+
+void gate_off(gate_t *obj) {
+    LPC_CTxxBx_Type *timer = obj->timer;
+
+    timer->EMR = (timer->EMR & ~(0x3 << (4 + 2 * obj->mr)))
+               | (1 << obj->mr)
+               | (EMC_NOTHING << (4 + 2 * obj->mr));
+}
+
+void gate_stop(void) {
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        if (timers_used & (1 << i)) {
+            Timers[i]->TCR = TCR_RESET;
+        }
+    }
+}
+
+void gate_start(void) {
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        if (timers_used & (1 << i)) {
+            Timers[i]->TCR = TCR_CNT_EN;
+        }
+    }
+}
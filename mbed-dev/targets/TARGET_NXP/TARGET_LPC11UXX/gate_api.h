@@ -0,0 +1,47 @@
+#ifndef MBED_GATE_API_H
+#define MBED_GATE_API_H
+
+#include "device.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Triac gate driven by a timer match output. gate_s is declared in objects.h
+ *
+ * The gate timers count microseconds from the last gate_start(). An armed gate
+ * pulls its pin low (gate on) when the count reaches its match value and
+ * stays on until gate_off(). Gates should only be armed while the timers are
+ * held by gate_stop(), so a match can't land in the middle of the update.
+ */
+typedef struct gate_s gate_t;
+
+/** Claim the match output on a pin
+ *
+ * @param obj The gate object to initialize
+ * @param pin The gate pin
+ * @return 1 if the pin has a usable match output, 0 if it has to stay on GPIO
+ */
+int gate_init(gate_t *obj, PinName pin);
+
+/** Turn the gate on us microseconds after the next gate_start()
+ */
+void gate_arm(gate_t *obj, uint32_t us);
+
+/** Turn the gate off and cancel any pending match
+ */
+void gate_off(gate_t *obj);
+
+/** Reset all gate timers and hold them at zero
+ */
+void gate_stop(void);
+
+/** Let all gate timers count from zero, e.g. at a zero crossing
+ */
+void gate_start(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -40,6 +40,11 @@ struct pwmout_s {
     PWMName pwm;
 };
 
+struct gate_s {
+    LPC_CTxxBx_Type *timer;
+    uint8_t mr;
+};
+
 struct serial_s {
     LPC_USART_Type *uart;
     int index;
@@ -152,7 +152,7 @@ void serial_baud(serial_t *obj, int baudrate) {
                     MulVal    = mv;
                     DivAddVal = dav;
 
-                    if (b == baudrate)
+                    if (b == 0)
                     {
                         hit = 1;
                         break;
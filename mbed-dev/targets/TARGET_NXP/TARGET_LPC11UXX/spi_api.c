@@ -21,6 +21,8 @@
 #include "mbed_error.h"
 #include "PeripheralPins.h" // For the Peripheral to Pin Definitions found in the individual Target's Platform
 
+#define SSP_FIFO_DEPTH 8
+
 static inline int ssp_disable(spi_t *obj);
 static inline int ssp_enable(spi_t *obj);
 
@@ -159,12 +161,23 @@ int spi_master_write(spi_t *obj, int value) {
 int spi_master_block_write(spi_t *obj, const char *tx_buffer, int tx_length,
                            char *rx_buffer, int rx_length, char write_fill) {
     int total = (tx_length > rx_length) ? tx_length : rx_length;
-
-    for (int i = 0; i < total; i++) {
-        char out = (i < tx_length) ? tx_buffer[i] : write_fill;
-        char in = spi_master_write(obj, out);
-        if (i < rx_length) {
-            rx_buffer[i] = in;
+    int sent = 0;
+    int received = 0;
+
+    // Keep the TX FIFO topped up while draining RX, so the bus never idles
+    // between bytes. No more than a FIFO's worth may be in flight or the
+    // receive FIFO would overrun.
+    while (received < total) {
+        while ((sent < total) && (sent - received < SSP_FIFO_DEPTH) && ssp_writeable(obj)) {
+            obj->spi->DR = (sent < tx_length) ? tx_buffer[sent] : write_fill;
+            sent++;
+        }
+        while ((received < sent) && ssp_readable(obj)) {
+            char in = obj->spi->DR;
+            if (received < rx_length) {
+                rx_buffer[received] = in;
+            }
+            received++;
         }
     }
 
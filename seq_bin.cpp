@@ -0,0 +1,20 @@
+#include "seq_bin.h"
+
+byte seq_bin_open(seq_file_t *fp) {
+    sSeqBinHeader header;
+
+    if (seq_fread(fp, &header, sizeof(header)) != sizeof(header)) {
+        return 0;
+    }
+    if (memcmp(header.magic, SEQ_BIN_MAGIC, sizeof(header.magic)) || (header.version != SEQ_BIN_VERSION)) {
+        return 0;
+    }
+    return header.count;
+}
+
+byte seq_bin_entry(seq_file_t *fp, byte index, sSeqBinEntry *entry) {
+    if (!seq_fseek(fp, sizeof(sSeqBinHeader) + index * sizeof(sSeqBinEntry))) {
+        return FALSE;
+    }
+    return (seq_fread(fp, entry, sizeof(sSeqBinEntry)) == sizeof(sSeqBinEntry));
+}
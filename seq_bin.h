@@ -0,0 +1,45 @@
+#ifndef SEQ_BIN_H
+#define SEQ_BIN_H
+
+#include "mbed.h"
+#include "types.h"
+#include "dim_steps.h"
+#include "seq_file.h"
+
+/* seq.bin, the indexed form of seq.txt built by seq_convert.py. Everything
+   is little endian:
+
+      header   "FTSQ", version, sequence count, 2 reserved bytes
+      index    one sSeqBinEntry per sequence
+      steps    the packed sDimStep records of every sequence
+
+   A sequence is found by scanning the small index and is then read with one
+   seek, so the load time doesn't depend on how many sequences the card
+   holds. The CRC-16 (see crc16.h) covers the sequence's step records. */
+
+#define SEQ_BIN_MAGIC   "FTSQ"
+#define SEQ_BIN_VERSION 1
+
+typedef struct {
+    char magic[4];
+    uint8_t version;
+    uint8_t count;              /* Entries in the index. */
+    uint8_t reserved[2];
+    } sSeqBinHeader;
+
+typedef struct {
+    uint8_t sequence;
+    uint8_t reserved;
+    uint16_t crc;               /* CRC-16 of the step records. */
+    uint16_t steps;
+    uint16_t reserved2;
+    uint32_t offset;            /* From the start of the file to the first step. */
+    } sSeqBinEntry;
+
+/* Check the header. Returns the number of sequences, 0 if it isn't a seq.bin. */
+byte seq_bin_open(seq_file_t *fp);
+
+/* Read entry index of the index table. */
+byte seq_bin_entry(seq_file_t *fp, byte index, sSeqBinEntry *entry);
+
+#endif
@@ -0,0 +1,84 @@
+# Builds seq.bin, the indexed binary form of seq.txt, for the SD card.
+#
+#   python seq_convert.py [seq.txt] [seq.bin]
+#
+# The layout is described in seq_bin.h. Sequences are read the same way the
+# firmware reads seq.txt: a Q line announces a sequence and its step count,
+# the S lines that follow are its steps (extra ones are dropped, missing ones
+# hold the level the last step ended on for one tick, see dim_step_hold()).
+
+import struct
+import sys
+
+MAGIC = b'FTSQ'
+VERSION = 1
+HEADER = '<4sBB2x'
+ENTRY = '<BxHHxxI'
+STEP_SIZE = 17
+
+
+def crc16(data, crc=0xFFFF):
+    for c in bytearray(data):
+        crc ^= c << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def read_sequences(path):
+    sequences = []
+    with open(path) as f:
+        for line in f:
+            fields = line.split()
+            if not fields:
+                continue
+            if fields[0] == 'Q':
+                sequences.append((int(fields[1]) & 0xFF, int(fields[2]), []))
+            elif fields[0] == 'S' and sequences:
+                number, steps, records = sequences[-1]
+                if len(records) < steps:
+                    values = [int(v) & 0xFF for v in fields[1:1 + STEP_SIZE]]
+                    records.append(bytes(bytearray(values)))
+    return sequences
+
+
+def pad(records, steps):
+    """Make up the steps a sequence is missing the way the firmware does:
+    the last step's stop levels, held for one tick (never 0 ticks)."""
+    if records:
+        levels = bytearray(records[-1])[2::2]
+    else:
+        levels = bytearray(8)
+    hold = bytearray([1])
+    for level in levels:
+        hold += bytearray([level, level])
+    return records + [bytes(hold)] * (steps - len(records))
+
+
+def main():
+    src = sys.argv[1] if len(sys.argv) > 1 else 'seq.txt'
+    dst = sys.argv[2] if len(sys.argv) > 2 else 'seq.bin'
+
+    sequences = read_sequences(src)
+    assert len(sequences) < 256, 'too many sequences for the index'
+
+    offset = struct.calcsize(HEADER) + len(sequences) * struct.calcsize(ENTRY)
+    index = b''
+    data = b''
+    for number, steps, records in sequences:
+        records = pad(records, steps)
+        body = b''.join(records)
+        index += struct.pack(ENTRY, number, crc16(body), steps, offset + len(data))
+        data += body
+
+    with open(dst, 'wb') as f:
+        f.write(struct.pack(HEADER, MAGIC, VERSION, len(sequences)))
+        f.write(index)
+        f.write(data)
+
+    print('%s: %d sequences, %d bytes' % (dst, len(sequences), offset + len(data)))
+
+
+if __name__ == '__main__':
+    main()
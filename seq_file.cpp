@@ -0,0 +1,108 @@
+#include "seq_file.h"
+
+/* dst gets src appended, as far as it fits before end. */
+static char *append(char *dst, const char *src, const char *end) {
+    while ((*src != '\0') && (dst < end)) {
+        *dst++ = *src++;
+    }
+    return dst;
+}
+
+#ifdef FT_NO_STDIO
+
+static FIL seq_fil;
+static byte seq_fil_open = FALSE;
+
+seq_file_t *seq_fopen(FATFileSystem *fs, const char *name, DWORD *table, UINT size) {
+    char path[SEQ_PATH_MAX];
+    char *p;
+
+    if (seq_fil_open) {
+        return NULL;
+    }
+
+    // "0:/name", the drive FatFs knows the file system by
+    p = append(path, fs->_fsid, path + sizeof(path) - 1);
+    p = append(p, ":/", path + sizeof(path) - 1);
+    p = append(p, name, path + sizeof(path) - 1);
+    *p = '\0';
+
+    if (f_open(&seq_fil, path, FA_READ) != FR_OK) {
+        return NULL;
+    }
+    if (table != NULL) {
+        seq_fil.cltbl = table;
+        table[0] = size;
+        if (f_lseek(&seq_fil, CREATE_LINKMAP) != FR_OK) {
+            seq_fil.cltbl = 0;      // too fragmented, seek the slow way
+        }
+    }
+    seq_fil_open = TRUE;
+    return &seq_fil;
+}
+
+word seq_fread(seq_file_t *fp, void *buf, word size) {
+    UINT n;
+
+    if (f_read(fp, buf, size, &n) != FR_OK) {
+        return 0;
+    }
+    return n;
+}
+
+byte seq_fseek(seq_file_t *fp, dword offset) {
+    return (f_lseek(fp, offset) == FR_OK) && (fp->fptr == offset);
+}
+
+void seq_fclose(seq_file_t *fp) {
+    f_close(fp);
+    seq_fil_open = FALSE;
+}
+
+#else
+
+static char seq_vbuf[SEQ_VBUF_SIZE];   // only one sequence file is ever open
+
+seq_file_t *seq_fopen(FATFileSystem *fs, const char *name, DWORD *table, UINT size) {
+    char path[SEQ_PATH_MAX];
+    char *p;
+    FILE *fp;
+
+    // "/sd/name", through the mount point
+    p = append(path, "/", path + sizeof(path) - 1);
+    p = append(p, fs->getName(), path + sizeof(path) - 1);
+    p = append(p, "/", path + sizeof(path) - 1);
+    p = append(p, name, path + sizeof(path) - 1);
+    *p = '\0';
+
+    if (table != NULL) {
+        fs->set_fastseek_table(table, size);
+    }
+    fp = fopen(path, "rb");
+    fs->set_fastseek_table(NULL, 0);    // fopen() may fail before it ever reaches the file system
+    if (fp != NULL) {
+        /* FatFs keeps the file's current sector in its FIL, so short reads
+           never go back to the card. But seq.bin is read 12 byte index
+           entries and 17 byte steps at a time, and unbuffered each would go
+           all the way down through the FileHandle on its own. A few of them
+           at a time come out of this buffer instead, without the BUFSIZ one
+           newlib would take from the heap. Block reads now come through it
+           in SEQ_VBUF_SIZE pieces, each still only a copy out of the FIL. */
+        setvbuf(fp, seq_vbuf, _IOFBF, sizeof(seq_vbuf));
+    }
+    return fp;
+}
+
+word seq_fread(seq_file_t *fp, void *buf, word size) {
+    return fread(buf, 1, size, fp);
+}
+
+byte seq_fseek(seq_file_t *fp, dword offset) {
+    return (fseek(fp, offset, SEEK_SET) == 0);
+}
+
+void seq_fclose(seq_file_t *fp) {
+    fclose(fp);
+}
+
+#endif
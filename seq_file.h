@@ -0,0 +1,37 @@
+#ifndef SEQ_FILE_H
+#define SEQ_FILE_H
+
+#include "mbed.h"
+#include "types.h"
+#include "FATFileSystem.h"
+
+/* Read-only access to the sequence files. Normally this goes through the
+   C library (fopen on the mount point, so the file is an mbed FileHandle
+   under a newlib FILE, both on the heap, with a small static buffer in
+   place of newlib's BUFSIZ one). Built with FT_NO_STDIO (make
+   STDIO=0) it calls FatFs directly on a single static FIL, which is all the
+   firmware ever has open at once, and none of stdio is needed. */
+
+#define SEQ_PATH_MAX    24
+#define SEQ_VBUF_SIZE   64      // the stdio build's FILE buffer, a few index entries or steps
+
+#ifdef FT_NO_STDIO
+typedef FIL seq_file_t;
+#else
+typedef FILE seq_file_t;
+#endif
+
+/* Open name in the root of fs. table (size DWORDs, or NULL) becomes the
+   file's fast seek link map, see FATFileSystem::set_fastseek_table(). NULL
+   if it can't be opened. */
+seq_file_t *seq_fopen(FATFileSystem *fs, const char *name, DWORD *table, UINT size);
+
+/* Up to size bytes into buf. Returns how many were read. */
+word seq_fread(seq_file_t *fp, void *buf, word size);
+
+/* TRUE once the next read starts offset bytes into the file. */
+byte seq_fseek(seq_file_t *fp, dword offset);
+
+void seq_fclose(seq_file_t *fp);
+
+#endif
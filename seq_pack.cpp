@@ -0,0 +1,88 @@
+#include "seq_pack.h"
+
+/* Decodes src on top of ptrStep, which holds the step before. */
+static const byte *unpack(sDimStep *ptrStep, const byte *src) {
+    byte starts, stops, bit;
+    int i;
+
+    ptrStep->ticks = *src++;
+    starts = *src++;
+    stops = *src++;
+
+    for (i = 0, bit = 1; i < 8; i++, bit <<= 1) {
+        ptrStep->Chan[i].start = (starts & bit) ? *src++ : ptrStep->Chan[i].stop;
+        ptrStep->Chan[i].stop = (stops & bit) ? *src++ : ptrStep->Chan[i].start;
+    }
+    return src;
+}
+
+static byte prev_stop(const sDimStep *ptrPrev, int i) {
+    return (ptrPrev != NULL) ? ptrPrev->Chan[i].stop : 0;
+}
+
+byte seq_pack_size(const sDimStep *ptrStep, const sDimStep *ptrPrev) {
+    byte size = 3;
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        if (ptrStep->Chan[i].start != prev_stop(ptrPrev, i)) {
+            size++;
+        }
+        if (ptrStep->Chan[i].stop != ptrStep->Chan[i].start) {
+            size++;
+        }
+    }
+    return size;
+}
+
+byte seq_pack(byte *dst, const sDimStep *ptrStep, const sDimStep *ptrPrev) {
+    byte *p = dst + 3;
+    byte starts = 0;
+    byte stops = 0;
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        if (ptrStep->Chan[i].start != prev_stop(ptrPrev, i)) {
+            starts |= 1 << i;
+            *p++ = ptrStep->Chan[i].start;
+        }
+        if (ptrStep->Chan[i].stop != ptrStep->Chan[i].start) {
+            stops |= 1 << i;
+            *p++ = ptrStep->Chan[i].stop;
+        }
+    }
+    dst[0] = ptrStep->ticks;
+    dst[1] = starts;
+    dst[2] = stops;
+    return p - dst;
+}
+
+/* Step 0, decoded on top of all off. */
+static void unpack_first(sSeqPackCursor *cursor) {
+    memset(&cursor->cur, 0, sizeof(cursor->cur));
+    cursor->step = 0;
+    cursor->next = unpack(&cursor->cur, cursor->base);
+}
+
+void seq_pack_open(sSeqPackCursor *cursor, const byte *base, word length) {
+    cursor->base = base;
+    cursor->length = length;
+    cursor->step = 0;
+    if (length > 0) {
+        unpack_first(cursor);
+    }
+}
+
+const sDimStep *seq_pack_step(sSeqPackCursor *cursor, word step) {
+    if (step >= cursor->length) {
+        return NULL;
+    }
+    if (step < cursor->step) {                      // back to the start and walk up from there
+        unpack_first(cursor);
+    }
+    while (cursor->step < step) {                   // normally just the one after
+        cursor->step++;
+        cursor->next = unpack(&cursor->cur, cursor->next);
+    }
+    return &cursor->cur;
+}
@@ -0,0 +1,52 @@
+#ifndef SEQ_PACK_H
+#define SEQ_PACK_H
+
+#include "mbed.h"
+#include "types.h"
+#include "dim_steps.h"
+
+/* The in-RAM form of a dimming sequence. Most channels either hold their
+   level or ramp on from where the step before left them, so rather than 17
+   bytes a step is stored as
+
+      ticks, start mask, stop mask, then for each channel in order:
+         start (its start bit set)
+         stop (its stop bit set)
+
+   A start is only stored when it differs from the channel's stop in the step
+   before (all off before step 0), a stop only when it differs from the
+   start. A channel holding its level takes nothing, a ramp carrying on from
+   the last one takes a byte, and a step takes 3 to 19 bytes. seq_pack.py
+   works out what each sequence in a seq.txt packs down to.
+
+   A step only decodes on top of the one before, which suits the way steps
+   are walked: forwards one at a time or back to the start. A cursor keeps
+   the current step decoded and the place of the next one, so the crossing
+   ISRs decode once per step, not once per crossing. */
+
+#define SEQ_PACK_MAX    (3 + 2 * 8)     // bytes in the largest packed step
+
+typedef struct {
+    const byte *base;           /* First packed step. */
+    const byte *next;           /* Packed step after the current one. */
+    word length;                /* Steps in the sequence. */
+    word step;                  /* Which step cur holds. */
+    sDimStep cur;
+    } sSeqPackCursor;
+
+/* Bytes ptrStep will take once packed after ptrPrev, NULL for step 0. */
+byte seq_pack_size(const sDimStep *ptrStep, const sDimStep *ptrPrev);
+
+/* Pack ptrStep into dst (seq_pack_size() bytes) coded against ptrPrev, the
+   step packed just before it or NULL for step 0. Returns the bytes written. */
+byte seq_pack(byte *dst, const sDimStep *ptrStep, const sDimStep *ptrPrev);
+
+/* Point cursor at length packed steps starting at base and decode step 0. */
+void seq_pack_open(sSeqPackCursor *cursor, const byte *base, word length);
+
+/* The decoded step, or NULL past the end of the sequence. The current step,
+   the one after it and step 0 are found straight away, any other step is
+   walked to from the start. */
+const sDimStep *seq_pack_step(sSeqPackCursor *cursor, word step);
+
+#endif
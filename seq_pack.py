@@ -0,0 +1,62 @@
+# Measures how small the packed in-RAM step form (seq_pack.h) makes each
+# sequence in seq.txt, and whether each one fits in the arena.
+#
+#   python seq_pack.py [seq.txt]
+#
+# Sequences are read the way the firmware reads them (see seq_convert.py).
+# Only one sequence is in the arena at a time, so each is judged on its own
+# packed size. While seq.txt is parsed its line buffer is borrowed from the
+# top of the arena, so a sequence loaded from seq.txt has less room than one
+# from seq.bin or the sync link. Keep ARENA_SIZE in step with LPC11U37.ld and
+# LINE_BUF_SIZE with line_reader.h.
+
+import sys
+
+from seq_convert import STEP_SIZE, pad, read_sequences
+
+ARENA_SIZE = 0xC00
+LINE_BUF_SIZE = 512
+PACKED_MAX = 3 + 2 * 8
+
+
+def packed_size(record, prev):
+    size = 3
+    for i in range(8):
+        start, stop = bytearray(record[1 + 2 * i:3 + 2 * i])
+        if start != (bytearray(prev)[2 + 2 * i] if prev else 0):
+            size += 1
+        if stop != start:
+            size += 1
+    return size
+
+
+def main():
+    src = sys.argv[1] if len(sys.argv) > 1 else 'seq.txt'
+    room_txt = ARENA_SIZE - LINE_BUF_SIZE
+
+    print('seq  steps    raw  packed  ratio  bytes/step  room txt/bin  fits')
+    for number, steps, records in read_sequences(src):
+        records = pad(records, steps)
+        raw = steps * STEP_SIZE
+        packed = 0
+        prev = None
+        for r in records:
+            packed += packed_size(r, prev)
+            prev = r
+        if packed == 0:
+            print('%3d  %5d  %5d  %6d' % (number, steps, raw, packed))
+            continue
+        # room: steps that would fit at this sequence's bytes per step, seq.txt / seq.bin
+        print('%3d  %5d  %5d  %6d  %5.2f  %10.1f  %7d/%-4d  %s' % (
+            number, steps, raw, packed, float(raw) / packed, float(packed) / steps,
+            room_txt * steps // packed, ARENA_SIZE * steps // packed,
+            'yes' if packed <= room_txt else 'bin only' if packed <= ARENA_SIZE else 'no'))
+
+    print('arena %d bytes, %d while seq.txt is parsed: any sequence of up to %d/%d steps fits,' % (
+        ARENA_SIZE, room_txt, room_txt // PACKED_MAX, ARENA_SIZE // PACKED_MAX))
+    print('longer ones depending on how they pack (%d/%d steps unpacked)' % (
+        room_txt // STEP_SIZE, ARENA_SIZE // STEP_SIZE))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,113 @@
+#include "seq_stream.h"
+#include "crc16.h"
+
+#define NO_HALF 0xFF
+
+static seq_file_t *stream_fp;
+static uint32_t stream_offset;                  /* File offset of step 0. */
+static word stream_length;                      /* Steps in the sequence, 0 when nothing is open. */
+
+static sDimStep *halves[2];
+static word half_first[2];                      /* First step held by each half. */
+static word half_count[2];
+static volatile byte half_ready[2];
+
+static volatile byte fill_half = NO_HALF;       /* Half the ISR wants refilled. */
+static volatile word fill_first;                /* Step it should start at. */
+
+static byte stream_load(byte h, word first) {
+    word count = stream_length - first;
+
+    if (count > STREAM_HALF_STEPS) {
+        count = STREAM_HALF_STEPS;
+    }
+    if (!seq_fseek(stream_fp, stream_offset + first * sizeof(sDimStep))) {
+        return FALSE;
+    }
+    if (seq_fread(stream_fp, halves[h], count * sizeof(sDimStep)) != count * sizeof(sDimStep)) {
+        return FALSE;
+    }
+    half_first[h] = first;
+    half_count[h] = count;
+    return TRUE;
+}
+
+byte seq_stream_open(seq_file_t *fp, const sSeqBinEntry *entry, sDimStep *buf) {
+    const byte *data;
+    word crc = 0xFFFF;
+    word first;
+    word n;
+
+    halves[0] = buf;
+    halves[1] = buf + STREAM_HALF_STEPS;
+    stream_fp = fp;
+    stream_offset = entry->offset;
+    stream_length = entry->steps;
+
+    // one pass over the sequence to check it, a half at a time
+    for (first = 0; first < stream_length; first += STREAM_HALF_STEPS) {
+        if (!stream_load(0, first)) {
+            stream_length = 0;
+            return FALSE;
+        }
+        data = (const byte *)halves[0];
+        for (n = half_count[0] * sizeof(sDimStep); n > 0; n--) {
+            crc = crc16(crc, *data++);
+        }
+    }
+    if ((stream_length == 0) || (crc != entry->crc)) {
+        stream_length = 0;
+        return FALSE;
+    }
+
+    // the start of the sequence and what follows it
+    first = (stream_length > STREAM_HALF_STEPS) ? STREAM_HALF_STEPS : 0;
+    if (!stream_load(0, 0) || !stream_load(1, first)) {
+        stream_length = 0;
+        return FALSE;
+    }
+    half_ready[0] = TRUE;
+    half_ready[1] = TRUE;
+    fill_half = NO_HALF;
+    return TRUE;
+}
+
+const sDimStep *seq_stream_step(word step) {
+    byte h, o;
+    word next;
+
+    for (h = 0; h < 2; h++) {
+        if (half_ready[h] && (step >= half_first[h]) && (step < half_first[h] + half_count[h])) {
+            break;
+        }
+    }
+    if (h == 2) {
+        return NULL;                            // underrun, or nothing open
+    }
+
+    // make sure the other half holds the steps that come next
+    next = half_first[h] + half_count[h];
+    if (next >= stream_length) {
+        next = 0;
+    }
+    o = 1 - h;
+    if ((fill_half == NO_HALF) && (next != half_first[h]) && !(half_ready[o] && (half_first[o] == next))) {
+        half_ready[o] = FALSE;
+        fill_first = next;
+        fill_half = o;
+    }
+
+    return &halves[h][step - half_first[h]];
+}
+
+void seq_stream_service(void) {
+    byte h = fill_half;
+
+    if (h == NO_HALF) {
+        return;
+    }
+    if (stream_load(h, fill_first)) {           // a failed read is simply retried next time round
+        half_ready[h] = TRUE;
+        fill_half = NO_HALF;
+    }
+}
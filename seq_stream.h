@@ -0,0 +1,31 @@
+#ifndef SEQ_STREAM_H
+#define SEQ_STREAM_H
+
+#include "mbed.h"
+#include "types.h"
+#include "dim_steps.h"
+#include "seq_bin.h"
+
+/* Plays a seq.bin sequence straight off the card instead of holding all of
+   it in RAM. Two halves of STREAM_HALF_STEPS steps are kept: the crossing
+   ISR reads from one while the main loop refills the other with the steps
+   that follow, wrapping back to the start of the sequence. Card reads only
+   ever happen in seq_stream_service(), never in the ISR. */
+
+#define STREAM_HALF_STEPS   30      // 510 bytes, about a sector
+
+#define STREAM_BUF_BYTES    (2 * STREAM_HALF_STEPS * sizeof(sDimStep))
+
+/* Check the sequence's CRC and fill both halves of buf (STREAM_BUF_BYTES).
+   The file and buf must stay while the sequence plays. FALSE on a read or
+   CRC error. */
+byte seq_stream_open(seq_file_t *fp, const sSeqBinEntry *entry, sDimStep *buf);
+
+/* From the crossing ISR: the step, or NULL if the card hasn't caught up
+   yet (try again at the next crossing). */
+const sDimStep *seq_stream_step(word step);
+
+/* From the main loop: refill the half the ISR has moved off. */
+void seq_stream_service(void);
+
+#endif
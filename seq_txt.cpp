@@ -0,0 +1,60 @@
+#include "seq_txt.h"
+#include "line_reader.h"
+
+static void seq_txt_step(const char *line, const char *end, sDimStep *ptrStep) {
+    unsigned int value;
+    int i;
+
+    value = 0;
+    line_uint(&line, end, &value);
+    ptrStep->ticks = (byte)(value & 0xFF);
+
+    for (i = 0; i < 8; i++) {
+        value = 0;
+        line_uint(&line, end, &value);
+        ptrStep->Chan[i].start = (byte)(value & 0xFF);
+        value = 0;
+        line_uint(&line, end, &value);
+        ptrStep->Chan[i].stop = (byte)(value & 0xFF);
+    }
+}
+
+void seq_txt_parse(seq_file_t *fp, char *buf, const sSeqTxtSink *sink) {
+    sLineReader reader;
+    sDimStep step;
+    const char *line;
+    const char *end;
+    word len;
+    unsigned int sequence;
+    unsigned int steps;
+    byte open = FALSE;
+
+    seq_fseek(fp, 0);
+    line_open(&reader, fp, buf, LINE_BUF_SIZE);
+    while ((line = line_next(&reader, &len)) != NULL) {
+        if (len == 0) {
+            continue;
+        }
+        end = line + len;
+
+        if (line[0] == 'Q') {
+            if (open) {
+                sink->finish();
+            }
+            line++;
+            sequence = 0;
+            steps = 0;
+            line_uint(&line, end, &sequence);
+            line_uint(&line, end, &steps);
+            sink->start(sequence, steps);
+            open = TRUE;
+        }
+        else if ((line[0] == 'S') && open) {
+            seq_txt_step(line + 1, end, &step);
+            sink->step(&step);
+        }
+    }
+    if (open) {
+        sink->finish();
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef SEQ_TXT_H
+#define SEQ_TXT_H
+
+#include "mbed.h"
+#include "types.h"
+#include "dim_steps.h"
+#include "seq_file.h"
+
+/* Parses seq.txt from the start, one line at a time in a LINE_BUF_SIZE
+   buffer the caller lends it. A Q line ("Q <sequence> <steps>") starts a
+   sequence and each S line after it ("S <ticks>" then start and stop for 8
+   channels) is one step. Fields are parsed where they lie in the buffer:
+   missing ones are 0 and only the low byte of each is kept. S lines before
+   the first Q line and all other lines are skipped. Whatever to do with the
+   steps, and how many of them to keep, is up to the sink. */
+
+typedef struct {
+    void (*start)(unsigned int sequence, unsigned int steps);
+    void (*step)(const sDimStep *ptrStep);
+    void (*finish)(void);          // after the last S line of each sequence
+    } sSeqTxtSink;
+
+void seq_txt_parse(seq_file_t *fp, char *buf, const sSeqTxtSink *sink);
+
+#endif
@@ -0,0 +1,235 @@
+#include "ser_fmt.h"
+
+/* What came between the '%' and the conversion. */
+typedef struct {
+    byte left;              /* '-' flag */
+    byte zero;              /* '0' flag */
+    byte alt;               /* '#' flag */
+    char sign;              /* '+' or ' ' flag, 0 for neither */
+    int width;
+    int precision;          /* -1 if none */
+    byte lng;               /* 0 int, 1 long, 2 long long */
+    } sSerSpec;
+
+static void put_padding(RawSerial *port, char c, int n) {
+    while (n-- > 0) {
+        port->putc(c);
+    }
+}
+
+/* prefix ("-", "0x", "" ...) then n digits, least significant first, padded out to the width. */
+static void put_field(RawSerial *port, const sSerSpec *spec, const char *prefix, const char *digits, byte n) {
+    int len = strlen(prefix) + n;
+
+    if (!spec->left && !spec->zero) {
+        put_padding(port, ' ', spec->width - len);
+    }
+    while (*prefix != '\0') {
+        port->putc(*prefix++);
+    }
+    if (!spec->left && spec->zero) {
+        put_padding(port, '0', spec->width - len);
+    }
+    while (n > 0) {
+        port->putc(digits[--n]);
+    }
+    if (spec->left) {
+        put_padding(port, ' ', spec->width - len);
+    }
+}
+
+static void put_unsigned(RawSerial *port, const sSerSpec *spec, const char *prefix, unsigned long long value, byte base, byte upper) {
+    const char *hex = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char digits[3 * sizeof(unsigned long long)];    /* at most 3 decimal digits a byte */
+    unsigned long v;
+    byte n = 0;
+
+    while (value > 0xFFFFFFFFUL) {                  /* 64 bit division only while it's needed */
+        digits[n++] = hex[value % base];
+        value /= base;
+    }
+    v = (unsigned long)value;
+    do {
+        digits[n++] = hex[v % base];
+        v /= base;
+    } while (v != 0);
+
+    put_field(port, spec, prefix, digits, n);
+}
+
+static void put_string(RawSerial *port, const sSerSpec *spec, const char *s) {
+    int len = 0;
+
+    if (s == NULL) {
+        s = "(null)";
+    }
+    while ((s[len] != '\0') && ((spec->precision < 0) || (len < spec->precision))) {
+        len++;
+    }
+    if (!spec->left) {
+        put_padding(port, ' ', spec->width - len);
+    }
+    for (int i = 0; i < len; i++) {
+        port->putc(s[i]);
+    }
+    if (spec->left) {
+        put_padding(port, ' ', spec->width - len);
+    }
+}
+
+void ser_printf(RawSerial *port, const char *format, ...) {
+    va_list args;
+
+    va_start(args, format);
+    ser_vprintf(port, format, args);
+    va_end(args);
+}
+
+void ser_vprintf(RawSerial *port, const char *format, va_list args) {
+    const char *start;
+    sSerSpec spec;
+    long long value;
+    unsigned long long uvalue;
+    char prefix[3];
+    char c;
+
+    while (*format != '\0') {
+        if (*format != '%') {
+            port->putc(*format++);
+            continue;
+        }
+        start = format++;
+
+        // flags, width, precision and length, as far as they matter here
+        spec.left = FALSE;
+        spec.zero = FALSE;
+        spec.alt = FALSE;
+        spec.sign = 0;
+        for (;; format++) {
+            if (*format == '-') {
+                spec.left = TRUE;
+            }
+            else if (*format == '0') {
+                spec.zero = TRUE;
+            }
+            else if (*format == '#') {
+                spec.alt = TRUE;
+            }
+            else if (*format == '+') {
+                spec.sign = '+';
+            }
+            else if (*format == ' ') {
+                if (spec.sign == 0) {
+                    spec.sign = ' ';
+                }
+            }
+            else {
+                break;
+            }
+        }
+        spec.width = 0;
+        if (*format == '*') {
+            spec.width = va_arg(args, int);
+            if (spec.width < 0) {
+                spec.left = TRUE;
+                spec.width = -spec.width;
+            }
+            format++;
+        }
+        while ((*format >= '0') && (*format <= '9')) {
+            spec.width = spec.width * 10 + (*format++ - '0');
+        }
+        spec.precision = -1;
+        if (*format == '.') {
+            format++;
+            spec.precision = 0;
+            if (*format == '*') {
+                spec.precision = va_arg(args, int);
+                format++;
+            }
+            while ((*format >= '0') && (*format <= '9')) {
+                spec.precision = spec.precision * 10 + (*format++ - '0');
+            }
+        }
+        spec.lng = 0;
+        for (;; format++) {
+            if (*format == 'l') {
+                spec.lng++;
+            }
+            else if ((*format == 'j') || (*format == 'L') || (*format == 'q')) {
+                spec.lng = 2;
+            }
+            else if ((*format == 'z') || (*format == 't')) {
+                spec.lng = (sizeof(size_t) > sizeof(int)) ? 1 : 0;
+            }
+            else if (*format != 'h') {
+                break;
+            }
+        }
+
+        c = *format;
+        switch (c) {
+        case 'd':
+        case 'i':
+            value = (spec.lng > 1) ? va_arg(args, long long) : ((spec.lng == 1) ? va_arg(args, long) : va_arg(args, int));
+            prefix[0] = (value < 0) ? '-' : spec.sign;
+            prefix[1] = '\0';
+            put_unsigned(port, &spec, prefix, (value < 0) ? -(unsigned long long)value : value, 10, FALSE);
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            uvalue = (spec.lng > 1) ? va_arg(args, unsigned long long) : ((spec.lng == 1) ? va_arg(args, unsigned long) : va_arg(args, unsigned int));
+            prefix[0] = '\0';
+            if (spec.alt && (uvalue != 0) && (c != 'u')) {      // "0x", "0X" or "0"
+                prefix[0] = '0';
+                prefix[1] = (c == 'o') ? '\0' : c;
+                prefix[2] = '\0';
+            }
+            put_unsigned(port, &spec, prefix, uvalue, (c == 'u') ? 10 : ((c == 'o') ? 8 : 16), (c == 'X'));
+            break;
+        case 'p':
+            put_unsigned(port, &spec, "0x", (unsigned long)va_arg(args, void *), 16, FALSE);
+            break;
+        case 's':
+            put_string(port, &spec, va_arg(args, const char *));
+            break;
+        case 'c':
+            port->putc(va_arg(args, int));
+            break;
+        case '%':
+            port->putc('%');
+            break;
+        case '\0':
+            return;
+        default:
+            // not one of ours: take its argument so the rest still line up, and write it out as it stands
+            if ((c == 'e') || (c == 'E') || (c == 'f') || (c == 'F') || (c == 'g') || (c == 'G') || (c == 'a') || (c == 'A')) {
+                if (spec.lng > 1) {
+                    va_arg(args, long double);
+                }
+                else {
+                    va_arg(args, double);
+                }
+            }
+            else if (c == 'n') {
+                va_arg(args, void *);
+            }
+            else if (spec.lng > 1) {
+                va_arg(args, long long);
+            }
+            else if (spec.lng == 1) {
+                va_arg(args, long);
+            }
+            else {
+                va_arg(args, int);
+            }
+            while (start <= format) {
+                port->putc(*start++);
+            }
+            break;
+        }
+        format++;
+    }
+}
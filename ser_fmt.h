@@ -0,0 +1,19 @@
+#ifndef SER_FMT_H
+#define SER_FMT_H
+
+#include <stdarg.h>
+#include "mbed.h"
+#include "types.h"
+
+/* A printf for the status messages that only knows integers, so newlib's
+   vfprintf (and its floating point) isn't linked in for them. It also gets
+   mbed's own error messages in the FT_NO_STDIO build. Understands %d, %i,
+   %u, %x, %X, %o, %p, %s, %c and %%, with printf's flags and width and
+   any of its length modifiers (h, l, ll, j, z, t). The precision only limits
+   %s. Any other conversion, floating point included, still takes its
+   argument but is written out as it stands. */
+
+void ser_printf(RawSerial *port, const char *format, ...);
+void ser_vprintf(RawSerial *port, const char *format, va_list args);
+
+#endif
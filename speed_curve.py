@@ -0,0 +1,55 @@
+# Generates speed_curve.h, the potentiometer to step time lookup table.
+#
+# The speed potentiometer is read as a 10-bit ADC code. The table gives the
+# step time in clocks (1/60th of a second) for every code, following the same
+# exponential curve the firmware used to evaluate in floating point:
+#
+#   FASTEST_TIME + SLOPE * (A_COEFF * exp(B_COEFF * (1.0 - pot)) + C_COEFF)
+#
+# Keep FASTEST_TIME and SLOWEST_TIME in step with main.cpp.
+
+import math
+import struct
+
+FASTEST_TIME = 10.0
+SLOWEST_TIME = 300.0
+SLOPE = SLOWEST_TIME - FASTEST_TIME
+
+# These coefficients are used to convert the potentiometer input to a
+# exponetial curve that mimics the desired response.
+A_COEFF = 0.0207
+B_COEFF = 3.9
+C_COEFF = -0.0207
+
+ADC_RANGE = 0x3FF
+
+
+def f32(x):
+    return struct.unpack('f', struct.pack('f', x))[0]
+
+
+table = []
+for code in range(ADC_RANGE + 1):
+    # AnalogIn::read() scales the code in single precision
+    pot = f32(code * f32(1.0 / ADC_RANGE))
+
+    # the master dimmer loop: dimmer_speed in double precision
+    clks = int(FASTEST_TIME + (SLOPE * (A_COEFF * math.exp(B_COEFF * (1.0 - pot)) + C_COEFF)))
+
+    # the master chase loop: speed was stored as a float first
+    speed = f32(A_COEFF * math.exp(B_COEFF * (1.0 - pot)) + C_COEFF)
+    chase_clks = int(SLOPE * speed + FASTEST_TIME)
+
+    assert abs(clks - chase_clks) <= 1, (code, clks, chase_clks)
+    table.append(clks)
+
+with open('speed_curve.h', 'w') as f:
+    f.write('/* Generated by speed_curve.py, do not edit. */\n')
+    f.write('\n')
+    f.write('/* Step time in clocks (1/60th of a second) for each 10-bit potentiometer code. */\n')
+    f.write('#define SPEED_CURVE_SIZE %d\n' % (ADC_RANGE + 1))
+    f.write('\n')
+    f.write('const uint16_t speed_curve[SPEED_CURVE_SIZE] = {\n')
+    for i in range(0, len(table), 16):
+        f.write('    ' + ', '.join('%3d' % v for v in table[i:i + 16]) + ',\n')
+    f.write('};\n')
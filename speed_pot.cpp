@@ -0,0 +1,78 @@
+#include "speed_pot.h"
+
+#define ADC_START_NOW   (1 << 24)
+#define ADC_START_MASK  (7 << 24)
+#define ADC_DONE        ((uint32_t)1 << 31)
+#define ADC_RANGE       0x3FF
+
+static analogin_t pot_adc;
+static Ticker tkr_Pot;
+
+static word pot_sum;            /* Samples summed so far in this update. */
+static byte pot_samples;
+static int pot_filter = -1;     /* Filtered sum, i.e. the code << 4. -1 until the first update. */
+
+static int pot_raw;             /* Unclamped code last published, what the hysteresis compares against. */
+static volatile word pot_code;
+static volatile word pot_count;
+
+static void speed_pot_isr(void) {
+    uint32_t data = LPC_ADC->GDR;
+    int code;
+
+    // start the next conversion straight away, it is done long before the next tick
+    LPC_ADC->CR = (LPC_ADC->CR & ~(0xFF | ADC_START_MASK)) | (1 << (int)pot_adc.adc) | ADC_START_NOW;
+
+    if (!(data & ADC_DONE)) {
+        return;
+    }
+    pot_sum += (data >> 6) & ADC_RANGE;
+    pot_samples++;
+
+    if (pot_samples < POT_OVERSAMPLE) {
+        return;
+    }
+
+    if (pot_filter < 0) {
+        pot_filter = pot_sum;
+    }
+    else {
+        pot_filter += ((int)pot_sum - pot_filter) >> POT_IIR_SHIFT;
+    }
+    pot_sum = 0;
+    pot_samples = 0;
+
+    code = (pot_filter + (POT_OVERSAMPLE / 2)) / POT_OVERSAMPLE;
+    if ((pot_count == 0) || (abs(code - pot_raw) > POT_HYSTERESIS)) {
+        pot_raw = code;
+
+        // snap to the rails within the dead band, otherwise the ends of speed_curve could never be picked
+        if (code <= POT_HYSTERESIS) {
+            code = 0;
+        }
+        else if (code >= ADC_RANGE - POT_HYSTERESIS) {
+            code = ADC_RANGE;
+        }
+        pot_code = code;
+        pot_count++;
+    }
+}
+
+void speed_pot_init(PinName pin) {
+    // power the ADC, set its clock and wire the pin
+    analogin_init(&pot_adc, pin);
+
+    LPC_ADC->CR = (LPC_ADC->CR & ~(0xFF | ADC_START_MASK)) | (1 << (int)pot_adc.adc) | ADC_START_NOW;
+    tkr_Pot.attach_us(&speed_pot_isr, POT_SAMPLE_US);
+
+    // wait for the first update so there is always a valid code
+    while (pot_count == 0);
+}
+
+word speed_pot_read(void) {
+    return pot_code;
+}
+
+word speed_pot_events(void) {
+    return pot_count;
+}
@@ -0,0 +1,30 @@
+#ifndef SPEED_POT_H
+#define SPEED_POT_H
+
+#include "mbed.h"
+#include "types.h"
+
+/* Samples the speed potentiometer in the background. A ticker starts one
+   conversion per period and collects the previous one, so nothing ever
+   waits on the ADC. Every POT_OVERSAMPLE samples are summed, run through an
+   IIR filter and published as a 10-bit code once the filtered value has
+   moved by more than POT_HYSTERESIS codes. Within POT_HYSTERESIS of either
+   end the published code is the end itself (0 or 1023), so the fastest and
+   slowest speeds can always be reached. */
+
+#define POT_SAMPLE_US   1000    // usec between conversions
+#define POT_OVERSAMPLE  16      // samples summed per filter update (about one AC cycle)
+#define POT_IIR_SHIFT   2       // each update moves the filter 1/4 of the way
+#define POT_HYSTERESIS  3       // codes the filtered value must move before it is published
+
+void speed_pot_init(PinName pin);
+
+/* The latest published 10-bit code. A single aligned load, so it is safe
+   to call from anywhere. */
+word speed_pot_read(void);
+
+/* Bumped every time a new code is published. Compare with the value seen
+   last time to find out whether the speed has changed. */
+word speed_pot_events(void);
+
+#endif
@@ -0,0 +1,382 @@
+#include "sync_link.h"
+#include "crc16.h"
+
+#define SYNC_FRAME_LEN  7
+#define SYNC_ANY        0
+
+#define LSR_TEMT        (1 << 6)
+
+/* Rates tried in turn. The first one is the power-up rate (MBED_CONF_PLATFORM_STDIO_BAUD_RATE). */
+static const int sync_rates[] = {9600, 19200, 38400, 57600, 115200, 230400};
+#define SYNC_RATES      (sizeof(sync_rates) / sizeof(sync_rates[0]))
+
+static RawSerial *sync_port;
+
+static byte rx_frame[SYNC_FRAME_LEN];
+static byte rx_len;                         /* Bytes of the current frame so far, 0 while hunting for SYNC_BYTE. */
+
+static word bulk_crc;
+static word bulk_count;                     /* Steps announced for the block being sent. */
+static word bulk_sent;
+static sDimStep bulk_last;                  /* The last step sent, held to pad out a short block. */
+static byte bulk_timeout;                   /* A read gave up; cleared by the next header. */
+
+static sSyncCmd mailbox[SYNC_MAILBOX];
+static volatile byte mb_head;               /* Only written by the receive interrupt. */
+static volatile byte mb_tail;               /* Only written by sync_get(). */
+
+static byte crc8(const byte *data, byte len) {
+    byte crc = 0;
+    byte i;
+
+    while (len--) {
+        crc ^= *data++;
+        for (i = 0; i < 8; i++) {
+            crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void bulk_putc(byte c) {
+    bulk_crc = crc16(bulk_crc, c);
+    sync_port->putc(c);
+}
+
+/* Slave: the next byte, or -1 once nothing has come for SYNC_BULK_TIMEOUT_MS. */
+static int bulk_rx(void) {
+    Timer t;
+
+    if (!sync_port->readable()) {
+        t.start();
+        while (!sync_port->readable()) {
+            if (t.read_ms() >= SYNC_BULK_TIMEOUT_MS) {
+                return -1;
+            }
+        }
+    }
+    return sync_port->getc();
+}
+
+static byte bulk_getc(void) {
+    int c;
+
+    if (bulk_timeout) {
+        return 0;
+    }
+    c = bulk_rx();
+    if (c < 0) {
+        bulk_timeout = TRUE;
+        return 0;
+    }
+    bulk_crc = crc16(bulk_crc, c);
+    return c;
+}
+
+static void sync_rx_byte(byte c) {
+    byte head;
+
+    if (rx_len == 0) {
+        if (c == SYNC_BYTE) {
+            rx_frame[rx_len++] = c;
+        }
+        return;
+    }
+
+    rx_frame[rx_len++] = c;
+    if (rx_len < SYNC_FRAME_LEN) {
+        return;
+    }
+    rx_len = 0;
+
+    if (crc8(&rx_frame[1], SYNC_FRAME_LEN - 2) != rx_frame[SYNC_FRAME_LEN - 1]) {
+        return;                             // garbled, hunt for the next frame
+    }
+
+    head = mb_head;
+    if (((head + 1) & (SYNC_MAILBOX - 1)) == mb_tail) {
+        return;                             // the ISRs are behind, drop it
+    }
+    mailbox[head].op = rx_frame[1];
+    mailbox[head].step = rx_frame[2] | (rx_frame[3] << 8);
+    mailbox[head].speed = rx_frame[4] | (rx_frame[5] << 8);
+    mb_head = (head + 1) & (SYNC_MAILBOX - 1);
+}
+
+static void sync_rx_isr(void) {
+    while (sync_port->readable()) {
+        sync_rx_byte(sync_port->getc());
+    }
+}
+
+/* Poll for a frame with the given opcode (or SYNC_ANY), dropping any others. */
+static byte sync_wait(sSyncCmd *cmd, byte op, int timeout_ms) {
+    Timer t;
+
+    t.start();
+    while (t.read_ms() < timeout_ms) {
+        if (sync_port->readable()) {
+            sync_rx_byte(sync_port->getc());
+        }
+        while (sync_get(cmd)) {
+            if ((op == SYNC_ANY) || (cmd->op == op)) {
+                return TRUE;
+            }
+        }
+    }
+    return FALSE;
+}
+
+/* Change rates once the last frame has completely left the shift register. */
+static void sync_baud(byte rate) {
+    while (!(LPC_USART->LSR & LSR_TEMT));
+    sync_port->baud(sync_rates[rate]);
+    rx_len = 0;
+}
+
+void sync_init(RawSerial *port) {
+    sync_port = port;
+}
+
+void sync_send(byte op, word step, word speed) {
+    byte frame[SYNC_FRAME_LEN];
+    byte i;
+
+    frame[0] = SYNC_BYTE;
+    frame[1] = op;
+    frame[2] = step & 0xFF;
+    frame[3] = (step >> 8) & 0xFF;
+    frame[4] = speed & 0xFF;
+    frame[5] = (speed >> 8) & 0xFF;
+    frame[6] = crc8(&frame[1], SYNC_FRAME_LEN - 2);
+
+    for (i = 0; i < SYNC_FRAME_LEN; i++) {
+        sync_port->putc(frame[i]);
+    }
+}
+
+/* Master: TRUE if anything at all arrives within timeout_ms once the last
+   frame has gone. Replies from several slaves collide and arrive garbled, so
+   any byte counts. */
+static byte sync_heard(int timeout_ms) {
+    Timer t;
+
+    while (!(LPC_USART->LSR & LSR_TEMT));
+    while (sync_port->readable()) {
+        sync_port->getc();                  // our own frame, if the line echoes it
+    }
+    t.start();
+    while (t.read_ms() < timeout_ms) {
+        if (sync_port->readable()) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/* Master: repeat a GO or DONE so a slave that misses one copy still acts on it. */
+static void sync_confirm(byte op, byte rate) {
+    byte i;
+
+    for (i = 0; i < SYNC_CONFIRM_REPEAT; i++) {
+        sync_send(op, rate, 0);
+    }
+}
+
+int sync_negotiate_master(void) {
+    byte good = 0;
+    byte rate;
+    byte acked;
+
+    for (rate = 1; rate < SYNC_RATES; rate++) {
+        sync_send(SYNC_PROBE, rate, 0);
+        sync_baud(rate);
+        wait_ms(SYNC_SETTLE_MS);
+
+        sync_send(SYNC_CHECK, rate, 0);
+        acked = sync_heard(SYNC_REPLY_MS);  // every slave has given up on the CHECK by now
+        sync_baud(good);
+        wait_ms(SYNC_SETTLE_MS);
+
+        sync_send(SYNC_QUERY, rate, 0);
+        if (!acked || sync_heard(SYNC_REPLY_MS)) {
+            break;                          // no slave at all, or one that can't follow
+        }
+        sync_confirm(SYNC_GO, rate);
+        sync_baud(rate);
+        wait_ms(SYNC_SETTLE_MS);
+        good = rate;
+    }
+
+    sync_confirm(SYNC_DONE, good);
+    return sync_rates[good];
+}
+
+int sync_negotiate_slave(void) {
+    sSyncCmd cmd;
+    byte good = 0;      /* The rate the master uses between rounds. */
+    byte checked = 0;   /* The last rate whose CHECK came through. */
+    byte rate;
+    int timeout = SYNC_LISTEN_MS;
+
+    while (sync_wait(&cmd, SYNC_ANY, timeout)) {
+        timeout = SYNC_REVERT_MS;
+        if (cmd.step >= SYNC_RATES) {
+            continue;
+        }
+
+        switch (cmd.op) {
+        case SYNC_PROBE:
+            rate = cmd.step;
+            sync_baud(rate);
+            if (sync_wait(&cmd, SYNC_CHECK, SYNC_REPLY_MS) && (cmd.step == rate)) {
+                checked = rate;
+                sync_send(SYNC_ACK, rate, 0);
+            }
+            sync_baud(good);
+            break;
+
+        case SYNC_QUERY:
+            if (checked != cmd.step) {
+                sync_send(SYNC_NAK, cmd.step, 0);
+            }
+            break;
+
+        case SYNC_GO:
+            good = cmd.step;
+            sync_baud(good);
+            break;
+
+        case SYNC_DONE:
+            if (good != cmd.step) {
+                good = cmd.step;
+                sync_baud(good);
+            }
+            return sync_rates[good];
+        }
+    }
+
+    return sync_rates[good];                // nothing (more) from the master
+}
+
+void sync_bulk_start(byte seq, word count) {
+    bulk_count = count;
+    bulk_sent = 0;
+
+    sync_port->putc(BULK_BYTE);
+    bulk_crc = 0xFFFF;
+    bulk_putc(seq);
+    bulk_putc(count & 0xFF);
+    bulk_putc((count >> 8) & 0xFF);
+}
+
+byte sync_bulk_step(const sDimStep *ptrStep) {
+    const byte *data = (const byte *)ptrStep;
+    byte i;
+
+    if (bulk_sent >= bulk_count) {
+        return FALSE;
+    }
+    for (i = 0; i < sizeof(sDimStep); i++) {
+        bulk_putc(data[i]);
+    }
+    bulk_last = *ptrStep;
+    bulk_sent++;
+    return TRUE;
+}
+
+void sync_bulk_finish(void) {
+    sDimStep pad;
+
+    dim_step_hold(&pad, (bulk_sent > 0) ? &bulk_last : NULL);
+    while (bulk_sent < bulk_count) {            // the file announced more steps than it had
+        sync_bulk_step(&pad);
+    }
+    sync_port->putc((bulk_crc >> 8) & 0xFF);
+    sync_port->putc(bulk_crc & 0xFF);
+    bulk_count = 0;
+}
+
+static void sync_bulk_end_block(byte kind) {
+    sync_port->putc(BULK_BYTE);
+    sync_port->putc(kind);
+    sync_port->putc(0);
+    sync_port->putc(0);
+}
+
+byte sync_bulk_end(byte last) {
+    if (!last) {
+        sync_bulk_end_block(BULK_END_PASS);
+        if (sync_heard(SYNC_REPLY_MS)) {
+            return TRUE;                    // someone missed their sequence, go again
+        }
+    }
+    sync_bulk_end_block(BULK_END_CLOSE);
+    return FALSE;
+}
+
+byte sync_bulk_header(byte *seq, word *count) {
+    int c;
+
+    do {
+        c = bulk_rx();
+        if (c < 0) {
+            return BULK_TIMEOUT;
+        }
+    } while (c != BULK_BYTE);
+
+    bulk_timeout = FALSE;
+    bulk_crc = 0xFFFF;
+    *seq = bulk_getc();
+    *count = bulk_getc();
+    *count |= bulk_getc() << 8;
+    if (bulk_timeout) {
+        return BULK_TIMEOUT;
+    }
+    if (*count != 0) {
+        return BULK_BLOCK;
+    }
+    return (*seq == BULK_END_CLOSE) ? BULK_END_CLOSE : BULK_END_PASS;
+}
+
+void sync_bulk_read(sDimStep *ptrSteps, word count) {
+    byte *data = (byte *)ptrSteps;
+    word n = count * sizeof(sDimStep);
+    byte c;
+
+    while (n--) {
+        c = bulk_getc();
+        if (data != NULL) {
+            *data++ = c;
+        }
+    }
+}
+
+byte sync_bulk_check(void) {
+    word crc = bulk_crc;
+    word received;
+
+    received = bulk_getc() << 8;
+    received |= bulk_getc();
+    return !bulk_timeout && (received == crc);
+}
+
+void sync_bulk_nak(void) {
+    sync_send(SYNC_NAK, 0, 0);
+}
+
+void sync_listen(void) {
+    rx_len = 0;
+    sync_port->attach(&sync_rx_isr, RawSerial::RxIrq);
+}
+
+byte sync_get(sSyncCmd *cmd) {
+    byte tail = mb_tail;
+
+    if (tail == mb_head) {
+        return FALSE;
+    }
+    *cmd = mailbox[tail];
+    mb_tail = (tail + 1) & (SYNC_MAILBOX - 1);
+    return TRUE;
+}
@@ -0,0 +1,119 @@
+#ifndef SYNC_LINK_H
+#define SYNC_LINK_H
+
+#include "mbed.h"
+#include "types.h"
+#include "dim_steps.h"
+
+/* Master to slave step sync. Every command is one binary frame:
+
+      +------+--------+---------+---------+----------+----------+-------+
+      | 0xA5 | opcode | step lo | step hi | speed lo | speed hi | CRC-8 |
+      +------+--------+---------+---------+----------+----------+-------+
+
+   The CRC-8 (polynomial 0x07) covers the opcode through the speed. Slaves
+   parse frames in the UART receive interrupt and pass them on through a
+   small lock-free mailbox that the chase and dimmer ISRs empty.
+
+   At boot the link is brought up to the fastest rate every slave can follow.
+   For each faster rate in turn the master announces it with a PROBE at the
+   current rate, switches and sends a CHECK, which each slave that hears it
+   answers with an ACK. Then everyone drops back to the current rate. There
+   the master sends a QUERY, and any slave that missed the CHECK answers with
+   a NAK. Several slaves may answer at once, so the master takes any byte at
+   all after the CHECK as an ACK and after the QUERY as a NAK. Only when some
+   slave answered the CHECK and the line stays quiet after the QUERY does the
+   master move everyone up with a GO, otherwise DONE closes the negotiation
+   at the current rate, 9600 baud if no slave ever answers. GO and DONE are sent SYNC_CONFIRM_REPEAT times, and a slave
+   acts on the first copy it hears. Slaves that never hear a PROBE stay at
+   9600 baud.
+
+   Dimming sequences are then streamed from the master in binary, one block
+   per sequence, and each slave keeps only its own:
+
+      +------+-----+----------+----------+- - - - - - - -+----------+----------+
+      | 0xA6 | seq | count lo | count hi | count sDimStep | crc[15:8] | crc[7:0] |
+      +------+-----+----------+----------+- - - - - - - -+----------+----------+
+
+   The CRC-16 (CCITT, 0xFFFF start) covers seq through the last step. A block
+   with a count of 0 and no CRC ends a pass, with BULK_END_PASS or
+   BULK_END_CLOSE in place of seq. After BULK_END_PASS a slave that has no
+   good copy of its sequence yet answers with a NAK, and the master sends
+   everything again, up to SYNC_BULK_PASSES times. Either way the transfer
+   finishes with BULK_END_CLOSE. A slave that still has nothing plays nothing,
+   as does one that hears nothing from the master for SYNC_BULK_TIMEOUT_MS
+   once the transfer has started. */
+
+#define SYNC_BYTE       0xA5
+#define BULK_BYTE       0xA6
+#define SYNC_RESTART    'R'     // the master restarted its sequence
+#define SYNC_STEP       'Z'     // the master moved to the next step
+#define SYNC_PROBE      'P'     // master: about to switch to rate index step
+#define SYNC_CHECK      'K'     // master: first frame at rate index step
+#define SYNC_ACK        'A'     // slave: the CHECK for rate index step came through
+#define SYNC_QUERY      'Q'     // master: did everyone get the CHECK for rate index step?
+#define SYNC_NAK        'N'     // slave: the CHECK for rate index step never came
+#define SYNC_GO         'G'     // master: everyone move to rate index step
+#define SYNC_DONE       'D'     // master: staying at rate index step
+
+#define SYNC_SETTLE_MS  5       // time for the slaves to switch rates
+#define SYNC_REPLY_MS   50      // how long to wait for a CHECK, an ACK or a NAK
+#define SYNC_REVERT_MS  200     // silence after which a slave stops negotiating
+#define SYNC_CONFIRM_REPEAT 3   // copies of each GO and DONE
+#define SYNC_LISTEN_MS  3000    // how long a slave waits for the master at boot
+
+#define SYNC_MAILBOX    4       // commands that can wait for the ISRs, a power of 2
+
+#define SYNC_BULK_PASSES        3       // most times the master sends the sequences
+#define SYNC_BULK_TIMEOUT_MS    250     // silence after which a slave stops waiting for a byte
+
+/* What sync_bulk_header() found. */
+#define BULK_BLOCK      0       // a block of count steps
+#define BULK_END_PASS   1       // the end of a pass, NAK now to get another
+#define BULK_END_CLOSE  2       // the end of the transfer
+#define BULK_TIMEOUT    3       // nothing for SYNC_BULK_TIMEOUT_MS
+
+typedef struct {
+    byte op;
+    word step;              /* The master's step index. */
+    word speed;             /* The master's step time in clocks. */
+    } sSyncCmd;
+
+void sync_init(RawSerial *port);
+
+/* Master: send one command frame. */
+void sync_send(byte op, word step, word speed);
+
+/* Bring the link up to the fastest rate that works. Both return the baud rate. */
+int sync_negotiate_master(void);
+int sync_negotiate_slave(void);
+
+/* Master: stream one sequence. Steps past count are ignored (FALSE) and
+   sync_bulk_finish() makes up missing ones with dim_step_hold(). */
+void sync_bulk_start(byte seq, word count);
+byte sync_bulk_step(const sDimStep *ptrStep);
+void sync_bulk_finish(void);
+
+/* Master: end a pass. TRUE if a slave asked for another one. After the last
+   pass, or when no slave asks, the transfer is closed. */
+byte sync_bulk_end(byte last);
+
+/* Slave: wait for the next block header. Returns one of the BULK_ codes. */
+byte sync_bulk_header(byte *seq, word *count);
+
+/* Slave: read count steps of the block into ptrSteps, or skip them if NULL. */
+void sync_bulk_read(sDimStep *ptrSteps, word count);
+
+/* Slave: read the block CRC. TRUE if the block came through intact and in time. */
+byte sync_bulk_check(void);
+
+/* Slave: after BULK_END_PASS, ask for another pass. */
+void sync_bulk_nak(void);
+
+/* Slave: start decoding frames in the receive interrupt. */
+void sync_listen(void);
+
+/* Slave: take the oldest command out of the mailbox. FALSE if it is empty. */
+byte sync_get(sSyncCmd *cmd);
+
+#endif
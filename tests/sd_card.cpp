@@ -0,0 +1,248 @@
+#include <deque>
+#include "mbed.h"
+#include "sd_card.h"
+
+#define CS_PIN      -1      // the only DigitalOut the SD driver has
+
+uint32_t sd_card_bytes;
+uint32_t sd_card_commands;
+int sd_card_sck = 100000;
+
+static std::deque<uint8_t> out;         // what the card clocks out next
+static uint8_t cmd[6];
+static int cmd_len;
+static int cs = 1;
+static int idle;
+static int acmd;
+static int acmd41_polls;
+static int multi;                       // streaming CMD18 blocks, the next one
+static int corrupt;
+static int max_sck;
+static uint64_t bus_ps;                 // time on the bus not yet added to the stub clock
+
+static uint8_t csd[16];
+
+static uint16_t crc16_xmodem(const uint8_t *data, int len) {
+    uint16_t crc = 0;
+    int i, b;
+
+    for (i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+uint8_t sd_card_data(uint32_t sector, int i) {
+    return (uint8_t)(sector * 7 + i * 13 + (i >> 8));
+}
+
+void sd_card_corrupt(int n) {
+    corrupt = n;
+}
+
+void sd_card_max_sck(int hz) {
+    max_sck = hz;
+}
+
+void sd_card_reset(void) {
+    out.clear();
+    cmd_len = 0;
+    idle = 1;
+    acmd = 0;
+    acmd41_polls = 0;
+    multi = -1;
+    corrupt = 0;
+    max_sck = 0;
+    sd_card_bytes = 0;
+    sd_card_commands = 0;
+
+    memset(csd, 0, sizeof(csd));
+    csd[0] = 0x40;                      // CSD version 2.0
+    csd[3] = SD_CARD_TRAN_SPEED;
+    csd[8] = ((SD_CARD_SECTORS / 1024 - 1) >> 8) & 0xFF;    // C_SIZE[15:0], bits 63:48
+    csd[9] = (SD_CARD_SECTORS / 1024 - 1) & 0xFF;
+}
+
+static void wait_us_on_bus(int us) {
+    int n = (int)(((uint64_t)us * sd_card_sck + 7999999) / 8000000);
+
+    while (n--) {
+        out.push_back(0xFF);
+    }
+}
+
+static void send_block(const uint8_t *data, int len, int wait) {
+    uint16_t crc = crc16_xmodem(data, len);
+    int flip = -1;
+    int i;
+
+    if ((corrupt > 0) || ((max_sck != 0) && (sd_card_sck > max_sck))) {
+        flip = len / 3;
+        if (corrupt > 0) {
+            corrupt--;
+        }
+    }
+    wait_us_on_bus(wait);
+    out.push_back(0xFE);
+    for (i = 0; i < len; i++) {
+        out.push_back((i == flip) ? (data[i] ^ 0x20) : data[i]);
+    }
+    out.push_back(crc >> 8);
+    out.push_back(crc & 0xFF);
+}
+
+static void send_sector(uint32_t sector, int wait) {
+    uint8_t data[512];
+    int i;
+
+    for (i = 0; i < 512; i++) {
+        data[i] = sd_card_data(sector, i);
+    }
+    send_block(data, 512, wait);
+}
+
+static void r1(uint8_t r) {
+    out.push_back(0xFF);                // NCR
+    out.push_back(r);
+}
+
+static void command(void) {
+    uint32_t arg = ((uint32_t)cmd[1] << 24) | (cmd[2] << 16) | (cmd[3] << 8) | cmd[4];
+    int index = cmd[0] & 0x3F;
+    int app = acmd;
+
+    sd_card_commands++;
+    acmd = 0;
+    out.clear();
+    multi = -1;
+
+    if (index == 12) {
+        out.push_back(0xFF);            // the stuff byte
+        out.push_back(0x00);
+        out.push_back(0x00);            // busy for a moment
+        out.push_back(0x00);
+        return;
+    }
+    if (idle && (index != 0) && (index != 8) && (index != 55) && (index != 41) && (index != 58)) {
+        r1(0x05);                       // illegal in idle
+        return;
+    }
+    switch (index) {
+    case 0:
+        idle = 1;
+        r1(0x01);
+        break;
+    case 8:
+        r1(0x01);
+        out.push_back(0x00);
+        out.push_back(0x00);
+        out.push_back(cmd[3]);
+        out.push_back(cmd[4]);
+        break;
+    case 55:
+        acmd = 1;
+        r1(idle);
+        break;
+    case 41:
+        if (!app) {
+            r1(idle | 0x04);
+        }
+        else {
+            if (++acmd41_polls > 2) {
+                idle = 0;
+            }
+            r1(idle);
+        }
+        break;
+    case 58:
+        r1(idle);
+        out.push_back(0xC0);            // powered up, high capacity
+        out.push_back(0xFF);
+        out.push_back(0x80);
+        out.push_back(0x00);
+        break;
+    case 9:
+        r1(0x00);
+        send_block(csd, 16, 0);
+        break;
+    case 16:
+        r1(0x00);
+        break;
+    case 17:
+    case 18:
+        if (arg >= SD_CARD_SECTORS) {
+            r1(0x20);                   // address error
+            break;
+        }
+        r1(0x00);
+        send_sector(arg, SD_CARD_ACCESS_US);
+        if (index == 18) {
+            multi = arg + 1;
+        }
+        break;
+    default:
+        r1(0x04);                       // illegal command
+        break;
+    }
+}
+
+static int transfer(int value) {
+    int r = 0xFF;
+
+    sd_card_bytes++;
+    bus_ps += 8000000000000ULL / sd_card_sck;
+    stub_now_us += bus_ps / 1000000;
+    bus_ps %= 1000000;
+
+    if (cs) {
+        return 0xFF;
+    }
+    if (out.empty() && (multi >= 0) && (multi < SD_CARD_SECTORS)) {
+        send_sector(multi++, SD_CARD_NEXT_US);
+    }
+    if (!out.empty()) {
+        r = out.front();
+        out.pop_front();
+    }
+
+    if ((cmd_len == 0) && ((value & 0xC0) != 0x40)) {
+        return r;                       // not the start of a command
+    }
+    cmd[cmd_len++] = value;
+    if (cmd_len == 6) {
+        cmd_len = 0;
+        command();
+    }
+    return r;
+}
+
+void stub_pin_write(PinName pin, int value) {
+    if (pin == CS_PIN) {
+        cs = value;
+    }
+}
+
+int SPI::write(int value) {
+    return transfer(value & 0xFF);
+}
+
+int SPI::write(const char *tx_buffer, int tx_length, char *rx_buffer, int rx_length) {
+    int total = (tx_length > rx_length) ? tx_length : rx_length;
+    int i;
+    int in;
+
+    for (i = 0; i < total; i++) {
+        in = transfer((i < tx_length) ? (uint8_t)tx_buffer[i] : 0xFF);
+        if (i < rx_length) {
+            rx_buffer[i] = in;
+        }
+    }
+    return total;
+}
+
+void SPI::frequency(int hz) {
+    sd_card_sck = hz;
+}
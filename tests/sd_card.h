@@ -0,0 +1,33 @@
+#ifndef TEST_SD_CARD_H
+#define TEST_SD_CARD_H
+
+#include <stdint.h>
+
+/* A simulated SDHC card in SPI mode on the other end of the stub SPI bus.
+   It answers the commands SDFileSystem uses to bring a card up and read it,
+   and makes every byte cost 8 SCK periods of the stub clock. A data block
+   waits SD_CARD_ACCESS_US after CMD17 or CMD18 and SD_CARD_NEXT_US between
+   the blocks of a CMD18. */
+
+#define SD_CARD_ACCESS_US   300
+#define SD_CARD_NEXT_US     10
+#define SD_CARD_SECTORS     65536
+#define SD_CARD_TRAN_SPEED  0x32        // 25 MHz
+
+void sd_card_reset(void);
+
+/* The byte at offset i of a sector. */
+uint8_t sd_card_data(uint32_t sector, int i);
+
+/* Flip a bit in the next n data blocks, leaving their CRC as it was. */
+void sd_card_corrupt(int n);
+
+/* Corrupt every data block sent with SCK above hz, 0 for no limit. */
+void sd_card_max_sck(int hz);
+
+/* What the bus has done since the last reset. */
+extern uint32_t sd_card_bytes;          // bytes clocked
+extern uint32_t sd_card_commands;       // commands received
+extern int sd_card_sck;                 // the current SCK
+
+#endif
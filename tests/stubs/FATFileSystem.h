@@ -0,0 +1,23 @@
+#ifndef TEST_FATFILESYSTEM_H
+#define TEST_FATFILESYSTEM_H
+
+#include <stdint.h>
+#include "FATFileSystem/ChaN/ff.h"
+
+/* Only the block device side, for testing the drivers underneath. */
+class FATFileSystem {
+public:
+    FATFileSystem(const char *n) {}
+    virtual ~FATFileSystem() {}
+
+    virtual int mount() { return disk_initialize(); }
+
+    virtual int disk_initialize() { return 0; }
+    virtual int disk_status() { return 0; }
+    virtual int disk_read(uint8_t *buffer, uint32_t sector, uint32_t count) = 0;
+    virtual int disk_write(const uint8_t *buffer, uint32_t sector, uint32_t count) = 0;
+    virtual int disk_sync() { return 0; }
+    virtual uint32_t disk_sectors() = 0;
+};
+
+#endif
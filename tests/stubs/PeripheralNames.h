@@ -0,0 +1,11 @@
+#ifndef TEST_PERIPHERALNAMES_H
+#define TEST_PERIPHERALNAMES_H
+
+#include "cmsis.h"
+
+typedef enum {
+    SPI_0 = LPC_SSP0_BASE,
+    SPI_1 = LPC_SSP1_BASE
+    } SPIName;
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef TEST_CMSIS_H
+#define TEST_CMSIS_H
+
+#include <stdint.h>
+
+/* The LPC11U registers the SPI HAL touches. DR and SR are backed by the SSP
+   model in test_spi.cpp, so every access goes through it. */
+
+uint32_t ssp_dr_read(void);
+void ssp_dr_write(uint32_t value);
+uint32_t ssp_sr_read(void);
+
+class SSPDataReg {
+public:
+    SSPDataReg &operator=(uint32_t value) { ssp_dr_write(value); return *this; }
+    operator uint32_t() { return ssp_dr_read(); }
+};
+
+class SSPStatusReg {
+public:
+    operator uint32_t() { return ssp_sr_read(); }
+};
+
+typedef struct {
+    uint32_t CR0;
+    uint32_t CR1;
+    SSPDataReg DR;
+    SSPStatusReg SR;
+    uint32_t CPSR;
+    } LPC_SSPx_Type;
+
+typedef struct {
+    uint32_t SYSAHBCLKCTRL;
+    uint32_t SSP0CLKDIV;
+    uint32_t SSP1CLKDIV;
+    uint32_t PRESETCTRL;
+    } LPC_SYSCON_Type;
+
+extern LPC_SYSCON_Type stub_syscon;
+#define LPC_SYSCON      (&stub_syscon)
+#define LPC_SSP0_BASE   0x40040000
+#define LPC_SSP1_BASE   0x40058000
+
+extern uint32_t SystemCoreClock;
+
+#endif
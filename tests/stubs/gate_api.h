@@ -0,0 +1,20 @@
+#ifndef MBED_GATE_API_H
+#define MBED_GATE_API_H
+
+#include "mbed.h"
+
+/* Host stand-in: the test decides which channels have a match output. */
+struct gate_s {
+    int pin;
+    int armed;                  /* 1 once armed, 0 once turned off */
+    uint32_t us;
+    };
+typedef struct gate_s gate_t;
+
+int gate_init(gate_t *obj, PinName pin);
+void gate_arm(gate_t *obj, uint32_t us);
+void gate_off(gate_t *obj);
+void gate_stop(void);
+void gate_start(void);
+
+#endif
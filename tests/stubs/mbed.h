@@ -0,0 +1,115 @@
+#ifndef TEST_MBED_H
+#define TEST_MBED_H
+
+/* Just enough of mbed for the firmware's pure logic to build on the host.
+   Each test provides the bodies of whatever it uses. */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+typedef int PinName;
+typedef uint64_t us_timestamp_t;
+
+typedef struct {
+    volatile uint32_t *reg_mpin;
+    } port_t;
+
+/* Time only moves when the code under test waits or polls for input, see
+   mbed_stub.cpp. */
+extern uint64_t stub_now_us;
+
+class Timer {
+public:
+    Timer() : t0(0), running(false) {}
+    void start(void) { t0 = stub_now_us; running = true; }
+    void stop(void) { running = false; }
+    void reset(void) { t0 = stub_now_us; }
+    int read_ms(void) { return (int)((stub_now_us - t0) / 1000); }
+    int read_us(void) { return (int)(stub_now_us - t0); }
+private:
+    uint64_t t0;
+    bool running;
+};
+
+void wait_ms(int ms);
+void wait_us(int us);
+void wait(float s);
+
+/* A serial port whose transmit side fills stub_tx and whose receive side
+   drains stub_rx. Polling an empty receiver advances the clock. */
+class RawSerial {
+public:
+    enum IrqType { RxIrq, TxIrq };
+    RawSerial(PinName tx, PinName rx) {}
+    int putc(int c);
+    int getc(void);
+    int readable(void);
+    void baud(int rate);
+    void attach(void (*fn)(void), IrqType type);
+};
+
+void stub_serial_loopback(void);        // move everything sent so far to the receiver
+void stub_serial_rx_irq(void);          // run the attached receive interrupt
+void stub_serial_later(int c, int delay_us);    // a byte that arrives delay_us from now
+extern int stub_baud;
+
+typedef struct {
+    volatile uint32_t LSR;
+    } stub_usart_t;
+extern stub_usart_t stub_usart;
+#define LPC_USART   (&stub_usart)
+
+extern uint32_t SystemCoreClock;
+
+/* Pin writes go to stub_pin_write(), which does nothing unless a test
+   provides its own. */
+void stub_pin_write(PinName pin, int value);
+
+class DigitalOut {
+public:
+    DigitalOut(PinName pin) : pin(pin), value(0) {}
+    DigitalOut &operator=(int v) { value = v; stub_pin_write(pin, v); return *this; }
+    operator int() { return value; }
+private:
+    PinName pin;
+    int value;
+};
+
+/* An SPI master. Tests that use it provide the device on the other end. */
+class SPI {
+public:
+    SPI(PinName mosi, PinName miso, PinName sclk) {}
+    int write(int value);
+    int write(const char *tx_buffer, int tx_length, char *rx_buffer, int rx_length);
+    void frequency(int hz);
+};
+
+/* ticker */
+typedef struct ticker_data_s ticker_data_t;
+const ticker_data_t *get_us_ticker_data(void);
+us_timestamp_t ticker_read_us(const ticker_data_t *data);
+
+/* A TimerEvent that keeps its queue the way the us_ticker list does: an
+   event inserted twice is reported rather than corrupting the list. */
+class TimerEvent {
+public:
+    TimerEvent() : queued(false), when(0) {}
+    virtual ~TimerEvent() {}
+
+    static TimerEvent *next(void);      // earliest queued event, NULL if none
+    static void fire(TimerEvent *event);
+    static int double_inserts;
+
+    bool queued;
+    us_timestamp_t when;
+
+protected:
+    virtual void handler(void) = 0;
+    void insert_absolute(us_timestamp_t timestamp);
+    void remove(void);
+};
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef TEST_MBED_ASSERT_H
+#define TEST_MBED_ASSERT_H
+
+#include <assert.h>
+
+#define MBED_ASSERT(expr)   assert(expr)
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef TEST_MBED_ERROR_H
+#define TEST_MBED_ERROR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static inline void error(const char *format, ...) {
+    printf("error(): %s\n", format);
+    exit(2);
+}
+
+#endif
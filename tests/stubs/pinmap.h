@@ -0,0 +1,19 @@
+#ifndef TEST_PINMAP_H
+#define TEST_PINMAP_H
+
+#include <stdint.h>
+
+typedef int PinName;
+#define NC  (-1)
+
+typedef struct {
+    PinName pin;
+    int peripheral;
+    int function;
+    } PinMap;
+
+uint32_t pinmap_peripheral(PinName pin, const PinMap *map);
+uint32_t pinmap_merge(uint32_t a, uint32_t b);
+void pinmap_pinout(PinName pin, const PinMap *map);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef TEST_SPI_API_H
+#define TEST_SPI_API_H
+
+#include "cmsis.h"
+#include "pinmap.h"
+
+/* The HAL switches on the SSP's address as an int, which a host pointer
+   doesn't fit in, so the pointer is wrapped. */
+class SSPPointer {
+public:
+    SSPPointer &operator=(LPC_SSPx_Type *p) { ptr = p; return *this; }
+    LPC_SSPx_Type *operator->() { return ptr; }
+    operator int() { return (int)(intptr_t)ptr; }
+private:
+    LPC_SSPx_Type *ptr;
+};
+
+struct spi_s {
+    SSPPointer spi;
+};
+
+typedef struct spi_s spi_t;
+
+#endif
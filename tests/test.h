@@ -0,0 +1,22 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+
+/* Each test is its own program: CHECK() counts failures, TEST_DONE()
+   reports them and sets the exit status. */
+
+static int test_failures;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            test_failures++; \
+        } \
+    } while (0)
+
+#define TEST_DONE() \
+    (printf("%s: %s\n", __FILE__, test_failures ? "FAILED" : "ok"), test_failures ? 1 : 0)
+
+#endif
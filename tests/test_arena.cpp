@@ -0,0 +1,60 @@
+/* The arena: aligned allocations, extensions, and a borrowed buffer off the
+   top that survives arena_reset() and squeezes what is left. */
+
+#include "test.h"
+#include "arena.h"
+
+#define SIZE    1024
+
+/* The linker script's section bounds. */
+extern "C" {
+    byte __arena_start__[SIZE] __attribute__((aligned(4)));
+}
+__asm__(".globl __arena_end__\n\t.set __arena_end__, __arena_start__ + 1024");
+
+static void test_alloc(void) {
+    byte *a;
+    byte *b;
+
+    arena_reset();
+    CHECK(arena_size() == SIZE);
+    a = (byte *) arena_extend(3);
+    CHECK(a == __arena_start__);
+    b = (byte *) arena_alloc(5);
+    CHECK(b == __arena_start__ + 4);    // aligned after the extension
+    CHECK(arena_alloc(SIZE) == NULL);
+    CHECK(arena_extend(SIZE - 12) != NULL);
+    CHECK(arena_extend(1) == NULL);
+    CHECK(arena_high_water() == SIZE);
+}
+
+static void test_borrow(void) {
+    byte *text;
+    byte *steps;
+
+    arena_reset();
+    text = (byte *) arena_borrow(510);
+    CHECK(text == __arena_start__ + SIZE - 512);
+    CHECK(arena_borrow(4) == NULL);                 // one at a time
+
+    arena_reset();                                  // a new sequence starts, the buffer stays
+    steps = (byte *) arena_extend(SIZE - 512);
+    CHECK(steps == __arena_start__);
+    CHECK(arena_extend(1) == NULL);                 // it never runs into the buffer
+    CHECK(arena_high_water() == SIZE);
+
+    arena_return();
+    CHECK(arena_extend(512) != NULL);               // and gets the room back once it's returned
+
+    arena_reset();
+    arena_extend(SIZE - 100);
+    CHECK(arena_borrow(200) == NULL);               // not over what is already in use
+    CHECK(arena_borrow(100) != NULL);
+    arena_return();
+}
+
+int main(void) {
+    test_alloc();
+    test_borrow();
+    return TEST_DONE();
+}
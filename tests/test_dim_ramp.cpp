@@ -0,0 +1,121 @@
+/* dim_ramp.cpp against the per-crossing division the ISRs used to do,
+   255 - (start + ((stop - start) * clocks) / total), and against the
+   exact (floating point) ramp it approximates.
+
+   It also weighs what a crossing costs on a Cortex-M0, which has no divide
+   instruction. The old way calls libgcc's __aeabi_idiv for every channel at
+   every crossing; its shift-and-subtract loop is modelled as a fixed entry
+   cost plus a cost per quotient bit. The incremental way divides twice per
+   channel once per step (ramp_begin) and only adds and compares at each
+   crossing. Instruction counts use the M0 timings (ALU 1, LDR/STR 2, taken
+   branch 3). */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "dim_ramp.h"
+
+#define DIV_CALL_CYCLES     24      // bl, sign handling, normalising the divisor, return
+#define DIV_BIT_CYCLES      6       // cmp, branch, sub, orr, two shifts per quotient bit
+#define OLD_CHAN_CYCLES     12      // loads, sub, mul, add, rsb, store around the division
+#define BEGIN_CHAN_CYCLES   20      // span, direction and five stores, around the divmod
+#define NEW_CHAN_CYCLES     30      // ramp_advance() and ramp_countdowns() for one channel
+
+static int worst;
+static double old_cycles;
+static double new_cycles;
+static long crossings;
+static int old_worst;               /* Most cycles any one crossing took the old way. */
+
+/* Cycles for __aeabi_idiv / __aeabi_uidivmod to divide n by d. */
+static int div_cycles(long n, long d) {
+    int bits = 0;
+
+    if (n < 0) {
+        n = -n;
+    }
+    while ((n >> bits) >= d) {
+        bits++;
+    }
+    return DIV_CALL_CYCLES + DIV_BIT_CYCLES * bits;
+}
+
+static void run_step(const sDimStep *step, word total) {
+    byte countdown[8];
+    int clocks, i, expect;
+    double exact;
+
+    ramp_begin(step, total);
+    for (i = 0; i < 8; i++) {
+        new_cycles += BEGIN_CHAN_CYCLES + div_cycles(abs(step->Chan[i].stop - step->Chan[i].start), total);
+    }
+    for (clocks = total; clocks >= 0; clocks--) {
+        int old = 0;
+
+        if (clocks != (int)total) {
+            ramp_advance();
+        }
+        ramp_countdowns(countdown);
+        new_cycles += 8 * NEW_CHAN_CYCLES;
+        crossings++;
+        for (i = 0; i < 8; i++) {
+            old += OLD_CHAN_CYCLES + div_cycles((long)(step->Chan[i].stop - step->Chan[i].start) * clocks, total);
+
+            expect = 255 - (step->Chan[i].start + ((step->Chan[i].stop - step->Chan[i].start) * clocks) / (int)total);
+            CHECK(countdown[i] == expect);
+
+            exact = 255.0 - (step->Chan[i].start + (step->Chan[i].stop - step->Chan[i].start) * (double)clocks / total);
+            if (fabs(countdown[i] - exact) > worst) {
+                worst = (int)ceil(fabs(countdown[i] - exact));
+            }
+        }
+        old_cycles += old;
+        if (old > old_worst) {
+            old_worst = old;
+        }
+    }
+}
+
+int main() {
+    sDimStep step;
+    word total;
+    int n, i;
+    byte one[8];
+    byte none[8];
+
+    srand(5);
+
+    // the corners: full swings both ways over the shortest and longest steps
+    for (i = 0; i < 8; i++) {
+        step.Chan[i].start = (i & 1) ? 255 : 0;
+        step.Chan[i].stop = (i & 1) ? 0 : 255;
+    }
+    run_step(&step, 1);
+    run_step(&step, 2);
+    run_step(&step, 255);
+    run_step(&step, 256);
+    run_step(&step, 300 * 255);     // slowest speed, longest tick count
+
+    ramp_begin(&step, 1);           // a 0 tick step is one clock, not a divide by 0
+    ramp_countdowns(one);
+    ramp_begin(&step, 0);
+    ramp_countdowns(none);
+    CHECK(memcmp(one, none, sizeof(one)) == 0);
+
+    for (n = 0; n < 3000; n++) {
+        for (i = 0; i < 8; i++) {
+            step.Chan[i].start = rand() % 256;
+            step.Chan[i].stop = (rand() % 4) ? rand() % 256 : step.Chan[i].start;
+        }
+        total = 1 + rand() % ((n % 10) ? 600 : 300 * 255);
+        run_step(&step, total);
+    }
+
+    CHECK(worst <= 1);              // truncation only, never more than a level off
+
+    printf("  per crossing, all 8 channels: division %.0f cycles (worst %d), incremental %.0f (%d + ramp_begin)\n",
+           old_cycles / crossings, old_worst, new_cycles / crossings, 8 * NEW_CHAN_CYCLES);
+    CHECK(new_cycles < old_cycles);
+    return TEST_DONE();
+}
@@ -0,0 +1,256 @@
+/* The event scheduler in dimmer.cpp against the 65 us slice ticker it
+   replaced: every output has to change at the same slice boundary the old
+   slice_timer_isr would have changed it at. The cycle is rendered into an
+   edge table up front, so there should be exactly one interrupt per
+   distinct firing slice plus the one that ends the cycle. Besides edge
+   cases and random countdowns it plays every crossing of every step in the
+   shipped seq.txt. */
+
+#include "test.h"
+#include "dimmer.h"
+#include "dim_ramp.h"
+#include "lights.h"
+#include "gate_api.h"
+
+/* ---- stand-ins ---- */
+
+static volatile uint32_t mpin;
+port_t lights_port = { &mpin };
+
+static us_timestamp_t now;
+const ticker_data_t *get_us_ticker_data(void) { return NULL; }
+us_timestamp_t ticker_read_us(const ticker_data_t *) { return now; }
+
+static TimerEvent *queue[4];
+static int queue_len;
+int TimerEvent::double_inserts;
+
+void TimerEvent::insert_absolute(us_timestamp_t timestamp) {
+    if (this->queued) {
+        double_inserts++;               // the real list would now be circular
+        return;
+    }
+    this->queued = true;
+    this->when = timestamp;
+    queue[queue_len++] = this;
+}
+
+void TimerEvent::remove(void) {
+    int i;
+
+    for (i = 0; i < queue_len; i++) {
+        if (queue[i] == this) {
+            queue[i] = queue[--queue_len];
+            break;
+        }
+    }
+    this->queued = false;
+}
+
+TimerEvent *TimerEvent::next(void) {
+    TimerEvent *first = NULL;
+    int i;
+
+    for (i = 0; i < queue_len; i++) {
+        if ((first == NULL) || (queue[i]->when < first->when)) {
+            first = queue[i];
+        }
+    }
+    return first;
+}
+
+void TimerEvent::fire(TimerEvent *event) {
+    event->remove();
+    now = event->when;
+    event->handler();
+}
+
+static byte hw_mask;
+static gate_t *gate_of[DIMMER_CHANNELS];
+
+int gate_init(gate_t *obj, PinName pin) {
+    obj->pin = pin;
+    obj->armed = 0;
+    gate_of[pin] = obj;
+    return (hw_mask >> pin) & 1;
+}
+void gate_arm(gate_t *obj, uint32_t us) { obj->armed = 1; obj->us = us; }
+void gate_off(gate_t *obj) { obj->armed = 0; }
+void gate_stop(void) {}
+void gate_start(void) {}
+
+static int cycles;
+static void done(void) { cycles++; }
+
+/* ---- the old slice ISR ---- */
+
+/* Port byte the old code had on the outputs at slice k (1 = first tick
+   after the zero crossing): a channel counted its Dimmer[] value down one
+   per tick and turned on at the tick that found it at 0, and tick 242 (the
+   one after zc_slice passed 240) turned everything off. */
+static byte old_port(const byte *countdown, int k, byte gpio) {
+    byte on = 0;
+    int i;
+
+    if (k >= 242) {
+        return 0xFF;
+    }
+    for (i = 0; i < DIMMER_CHANNELS; i++) {
+        if ((gpio & (1 << i)) && (countdown[i] + 1 <= k)) {
+            on |= 1 << i;
+        }
+    }
+    return 0xFF & ~CHANNELS_TO_PORT(on);
+}
+
+/* Distinct slices at which GPIO channels turn on, plus the one that ends
+   the cycle: the interrupts the edge table should take. */
+static int distinct_slots(const byte *countdown, byte gpio) {
+    byte seen[256] = {0};
+    int n = 1;
+    int i;
+
+    for (i = 0; i < DIMMER_CHANNELS; i++) {
+        if ((gpio & (1 << i)) && (countdown[i] < LAST_SLICE) && !seen[countdown[i]]) {
+            seen[countdown[i]] = 1;
+            n++;
+        }
+    }
+    return n;
+}
+
+/* Run one cycle and compare the port at every slice. */
+static void run_cycle(const byte *countdown) {
+    static const PinName pins[DIMMER_CHANNELS] = {0, 1, 2, 3, 4, 5, 6, 7};
+    byte gpio = ~hw_mask;
+    byte port = 0xFF;
+    int k, i, start;
+    int fired = 0;
+    us_timestamp_t last = 0;
+    TimerEvent *event;
+
+    dimmer_init(pins, &done);
+    now = 1000;
+    start = cycles;
+    mpin = 0xFFu << LIGHTS_SHIFT;
+    dimmer_start(countdown);
+    us_timestamp_t zc = now;
+
+    for (k = 1; k <= 242; k++) {
+        // everything due by this slice boundary
+        while (((event = TimerEvent::next()) != NULL) && (event->when <= zc + k * SLICE)) {
+            CHECK(event->when % SLICE == zc % SLICE);   // only ever on a boundary
+            CHECK(event->when > last);                  // one interrupt per distinct slice
+            last = event->when;
+            TimerEvent::fire(event);
+            fired++;
+        }
+        port = (byte)(mpin >> LIGHTS_SHIFT);
+        CHECK(port == old_port(countdown, k, gpio));
+    }
+    CHECK(TimerEvent::next() == NULL);
+    CHECK(cycles == start + 1);
+    CHECK(fired == distinct_slots(countdown, gpio));
+    CHECK(fired <= DIMMER_CHANNELS + 1);
+
+    for (i = 0; i < DIMMER_CHANNELS; i++) {
+        if (hw_mask & (1 << i)) {
+            CHECK(gate_of[i]->armed == 0);              // shut off at the end of the cycle
+        }
+    }
+}
+
+/* Every crossing of every step in seq.txt, as the crossing ISR ramps it with
+   ticks clocks to the step. Returns the number of steps. */
+static int run_seq_txt(const char *path) {
+    char line[128];
+    unsigned v[17];
+    sDimStep step;
+    byte countdown[DIMMER_CHANNELS];
+    int steps = 0;
+    int clocks, i;
+    FILE *fp;
+
+    fp = fopen(path, "r");
+    CHECK(fp != NULL);
+    if (fp == NULL) {
+        return 0;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if ((line[0] != 'S') || (sscanf(line + 1, "%u %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u",
+                &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8], &v[9], &v[10], &v[11],
+                &v[12], &v[13], &v[14], &v[15], &v[16]) != 17)) {
+            continue;
+        }
+        step.ticks = v[0];
+        for (i = 0; i < DIMMER_CHANNELS; i++) {
+            step.Chan[i].start = v[1 + 2 * i];
+            step.Chan[i].stop = v[2 + 2 * i];
+        }
+        ramp_begin(&step, step.ticks);
+        for (clocks = step.ticks; clocks >= 0; clocks--) {
+            if (clocks != step.ticks) {
+                ramp_advance();
+            }
+            ramp_countdowns(countdown);
+            run_cycle(countdown);
+        }
+        steps++;
+    }
+    fclose(fp);
+    return steps;
+}
+
+int main() {
+    static const byte edges[][DIMMER_CHANNELS] = {
+        {0, 0, 0, 0, 0, 0, 0, 0},
+        {255, 255, 255, 255, 255, 255, 255, 255},
+        {239, 240, 241, 242, 0, 1, 254, 255},
+        {10, 10, 10, 200, 200, 5, 5, 100},
+        {7, 6, 5, 4, 3, 2, 1, 0},
+    };
+    byte countdown[DIMMER_CHANNELS];
+    unsigned n, i;
+
+    srand(1);
+    for (hw_mask = 0; ; hw_mask = (hw_mask == 0) ? 0x0F : 0xFF) {
+        for (n = 0; n < sizeof(edges) / sizeof(edges[0]); n++) {
+            run_cycle(edges[n]);
+        }
+        for (n = 0; n < 2000; n++) {
+            for (i = 0; i < DIMMER_CHANNELS; i++) {
+                countdown[i] = rand() % 256;
+            }
+            run_cycle(countdown);
+        }
+        CHECK(run_seq_txt("../seq.txt") == 32);
+        if (hw_mask == 0xFF) {
+            break;
+        }
+    }
+
+    // hardware gates arm at the same slice the GPIO path would fire at
+    hw_mask = 0x0F;
+    for (i = 0; i < DIMMER_CHANNELS; i++) {
+        countdown[i] = i * 40;
+    }
+    static const PinName pins[DIMMER_CHANNELS] = {0, 1, 2, 3, 4, 5, 6, 7};
+    dimmer_init(pins, &done);
+    dimmer_start(countdown);
+    for (i = 0; i < 4; i++) {
+        CHECK(gate_of[i]->armed == 1);
+        CHECK(gate_of[i]->us == (uint32_t)(countdown[i] + 1) * SLICE);
+    }
+    countdown[0] = 250;
+    dimmer_start(countdown);
+    CHECK(gate_of[0]->armed == 0);
+
+    // a second zero crossing before the cycle has finished, e.g. a noisy
+    // edge, re-schedules the event rather than queueing it twice
+    CHECK(TimerEvent::double_inserts == 0);
+    while ((TimerEvent::next()) != NULL) {
+        TimerEvent::fire(TimerEvent::next());
+    }
+
+    return TEST_DONE();
+}
@@ -0,0 +1,198 @@
+/* The sector cache against a file-backed block device: LRU order, write-
+   through, pinning of the FAT, and multi-sector transfers that bypass it. */
+
+#include <string.h>
+#include "test.h"
+#include "FATFileSystem/ChaN/disk_cache.h"
+
+#define SECTORS     64
+#define FAT_START   1               // sectors [FAT_START, FAT_END) are pinned
+#define FAT_END     9
+
+static FILE *disk;
+static int reads;                   // sectors read from the device
+static int writes;
+static int fail_writes;
+
+static int file_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count) {
+    reads += count;
+    if (fseek(disk, (long) sector * _MAX_SS, SEEK_SET))
+        return 1;
+    return fread(buff, _MAX_SS, count, disk) != count;
+}
+
+static int file_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count) {
+    if (fail_writes) {
+        /* A card that gave up part way: the first sector made it. */
+        fseek(disk, (long) sector * _MAX_SS, SEEK_SET);
+        fwrite(buff, _MAX_SS, 1, disk);
+        return 1;
+    }
+    writes += count;
+    if (fseek(disk, (long) sector * _MAX_SS, SEEK_SET))
+        return 1;
+    return fwrite(buff, _MAX_SS, count, disk) != count;
+}
+
+static BYTE file_pinned(BYTE pdrv, DWORD sector) {
+    return sector >= FAT_START && sector < FAT_END;
+}
+
+static const CACHE_DEV dev = { file_read, file_write, file_pinned };
+
+static BYTE buf[4][_MAX_SS];
+
+/* Each sector starts out filled with its own number. */
+static void disk_reset(void) {
+    BYTE sector[_MAX_SS];
+
+    if (disk)
+        fclose(disk);
+    disk = tmpfile();
+    for (int i = 0; i < SECTORS; i++) {
+        memset(sector, i, sizeof(sector));
+        fwrite(sector, sizeof(sector), 1, disk);
+    }
+    cache_invalidate(0, 0, 0xFFFFFFFF);
+    reads = 0;
+    writes = 0;
+    fail_writes = 0;
+}
+
+/* Reads sector through the cache, TRUE if the device wasn't touched. */
+static bool hit(DWORD sector) {
+    int before = reads;
+
+    CHECK(cache_read(&dev, 0, buf[0], sector, 1) == 0);
+    return reads == before;
+}
+
+static bool filled(const BYTE *b, BYTE value) {
+    for (int i = 0; i < _MAX_SS; i++) {
+        if (b[i] != value)
+            return false;
+    }
+    return true;
+}
+
+static void test_lru(void) {
+    DWORD hits;
+    DWORD misses;
+    DWORD h0;
+    DWORD m0;
+
+    disk_reset();
+    disk_cache_stats(&h0, &m0);
+    for (int i = 0; i < _DISK_CACHE; i++)
+        CHECK(!hit(20 + i));
+    CHECK(filled(buf[0], 20 + _DISK_CACHE - 1));
+    CHECK(hit(20));                                 // now the most recent
+    CHECK(filled(buf[0], 20));
+    CHECK(!hit(30));                                // evicts the oldest, 21
+    CHECK(hit(20));
+    CHECK(hit(30));
+    CHECK(!hit(21));                                // evicts 20 or the next oldest
+    CHECK(!hit(_DISK_CACHE > 2 ? 22 : 20));
+    disk_cache_stats(&hits, &misses);
+    CHECK(hits - h0 == 3);
+    CHECK(misses - m0 == _DISK_CACHE + 3);
+
+    disk_reset();
+    CHECK(!hit(5 + FAT_END));
+    CHECK(hit(5 + FAT_END));
+    fclose(disk);                                   // a failed read isn't cached
+    disk = tmpfile();
+    CHECK(cache_read(&dev, 0, buf[0], 40, 1) != 0);
+    CHECK(cache_read(&dev, 0, buf[0], 40, 1) != 0);
+}
+
+static void test_write_through(void) {
+    BYTE raw[_MAX_SS];
+
+    disk_reset();
+    CHECK(!hit(30));
+    memset(buf[1], 0xA5, _MAX_SS);
+    CHECK(cache_write(&dev, 0, buf[1], 30, 1) == 0);
+    CHECK(writes == 1);
+    fseek(disk, 30L * _MAX_SS, SEEK_SET);           // the device has it
+    CHECK(fread(raw, sizeof(raw), 1, disk) == 1);
+    CHECK(filled(raw, 0xA5));
+    CHECK(hit(30));                                 // and so does the cache
+    CHECK(filled(buf[0], 0xA5));
+
+    CHECK(cache_write(&dev, 0, buf[1], 31, 1) == 0);
+    CHECK(!hit(31));                                // writes don't allocate
+
+    fail_writes = 1;                                // the card's copy is unknown now
+    memset(buf[1], 0x5A, _MAX_SS);
+    CHECK(cache_write(&dev, 0, buf[1], 30, 1) != 0);
+    CHECK(!hit(30));
+    CHECK(filled(buf[0], 0x5A));
+}
+
+static void test_pinned(void) {
+    disk_reset();
+    CHECK(!hit(FAT_START));
+    for (int i = 0; i < 3 * _DISK_CACHE; i++)       // a stream of data sectors
+        CHECK(!hit(40 + i));
+    CHECK(hit(FAT_START));                          // outlives them all
+    CHECK(hit(40 + 3 * _DISK_CACHE - 1));           // and leaves them a slot
+
+    for (int i = 1; i < _DISK_CACHE - 1; i++)       // the FAT fills all but one slot
+        CHECK(!hit(FAT_START + i));
+    CHECK(hit(40 + 3 * _DISK_CACHE - 1));
+    CHECK(!hit(FAT_START + _DISK_CACHE - 1));       // then takes the oldest FAT slot
+    CHECK(hit(40 + 3 * _DISK_CACHE - 1));
+    CHECK(!hit(FAT_START));
+}
+
+static void test_multi_sector(void) {
+    DWORD hits;
+    DWORD misses;
+    DWORD h0;
+    DWORD m0;
+
+    disk_reset();
+    CHECK(!hit(31));
+    disk_cache_stats(&h0, &m0);
+    CHECK(cache_read(&dev, 0, buf[0], 30, 3) == 0); // straight from the device
+    CHECK(reads == 4);
+    CHECK(filled(buf[1], 31));
+    disk_cache_stats(&hits, &misses);
+    CHECK(hits == h0);
+    CHECK(misses == m0);
+    CHECK(!hit(30));                                // nothing was cached
+    CHECK(hit(31));                                 // nor dropped
+
+    memset(buf[0], 0x11, sizeof(buf[0]));           // a write across a cached sector
+    memset(buf[1], 0x22, sizeof(buf[1]));
+    memset(buf[2], 0x33, sizeof(buf[2]));
+    CHECK(cache_write(&dev, 0, buf[0], 30, 3) == 0);
+    CHECK(hit(30));
+    CHECK(filled(buf[0], 0x11));
+    CHECK(hit(31));
+    CHECK(filled(buf[0], 0x22));
+
+    fail_writes = 1;                                // a failed one drops every copy
+    memset(buf[0], 0x44, sizeof(buf[0]));
+    CHECK(cache_write(&dev, 0, buf[0], 29, 3) != 0);
+    CHECK(!hit(30));
+    CHECK(!hit(31));
+    CHECK(filled(buf[0], 0x22));                    // only the first sector got there
+    CHECK(!hit(29));
+    CHECK(filled(buf[0], 0x44));
+
+    CHECK(hit(31));                                 // another drive's sectors are its own
+    cache_invalidate(1, 0, 0xFFFFFFFF);
+    CHECK(hit(31));
+    cache_invalidate(0, 31, 1);
+    CHECK(!hit(31));
+}
+
+int main(void) {
+    test_lru();
+    test_write_through();
+    test_pinned();
+    test_multi_sector();
+    return TEST_DONE();
+}
@@ -0,0 +1,105 @@
+/* lights.h's port byte mappings against the pins the old code drove, and
+   what a chase update costs on a Cortex-M0: one MPIN store against the
+   BusOut::write() loop of per-pin SET/CLR stores. The cycles come from the
+   M0's instruction timings (ALU 1, LDR/STR 2, taken branch 3, BL 4) applied
+   to the instructions each path needs, the stores from running a model of
+   the old loop that has to end on the same pins as lights_write(). */
+
+#include "test.h"
+#include "lights.h"
+
+/* BusOut::write() with gpio_write() inlined, per slot of its 16 */
+#define BUS_PIN_CYCLES  21      // ldr _pin[i], cmp/beq, shift/and, test value, ldr reg, ldr mask, str, loop
+#define BUS_NC_CYCLES   11      // ldr _pin[i], cmp, taken beq, loop
+#define BUS_CALL_CYCLES 14      // bl, push, pop and return; PlatformMutex is empty without the RTOS
+#define SHUFFLE_CYCLES  32      // PATTERN_TO_PORT: mask, and, shift, orr for each bit
+#define STORE_CYCLES    7       // ldr lights_port, ldr reg_mpin, lsl, str
+
+static volatile uint32_t mpin;
+port_t lights_port = { &mpin };
+
+/* DigitalOut C0..C7 in the old main.cpp */
+static const int channel_pin[8] = {16, 20, 17, 21, 18, 22, 19, 23};
+
+/* BusOut lights(P0_23, P0_19, P0_22, P0_18, P0_21, P0_17, P0_20, P0_16),
+   bit 0 of the pattern is the first pin. */
+static const int pattern_pin[8] = {23, 19, 22, 18, 21, 17, 20, 16};
+
+/* The old chase path: BusOut's 16 slots, the first 8 holding DigitalOuts
+   that store their pin's mask to the port's SET or CLR register. */
+static uint32_t bus_pins;
+static int bus_stores;
+static int bus_cycles;
+static int bus_skew;                    /* Cycles from the first pin store to the last. */
+
+static void bus_write(int value) {
+    int first = -1;
+    int i;
+
+    bus_cycles += BUS_CALL_CYCLES;
+    for (i = 0; i < 16; i++) {
+        if (i < 8) {
+            bus_cycles += BUS_PIN_CYCLES;
+            if ((value >> i) & 1) {
+                bus_pins |= 1u << pattern_pin[i];         // *reg_set = mask
+            }
+            else {
+                bus_pins &= ~(1u << pattern_pin[i]);      // *reg_clr = mask
+            }
+            bus_stores++;
+            if (first < 0) {
+                first = bus_cycles;
+            }
+            bus_skew = bus_cycles - first;
+        }
+        else {
+            bus_cycles += BUS_NC_CYCLES;
+        }
+    }
+}
+
+static void benchmark(void) {
+    unsigned v;
+
+    for (v = 0; v < 256; v++) {
+        bus_write(v);
+        lights_write(v);
+        CHECK(mpin == bus_pins);                        // the same pins either way
+    }
+    CHECK(bus_stores == 8 * 256);
+
+    printf("  BusOut::write:  %d stores, %d cycles, pins change over %d cycles\n",
+           bus_stores / 256, bus_cycles / 256, bus_skew);
+    printf("  lights_write:   1 store, %d cycles (%d from a port byte), all pins at once\n",
+           SHUFFLE_CYCLES + STORE_CYCLES, STORE_CYCLES);
+    CHECK(SHUFFLE_CYCLES + STORE_CYCLES < bus_cycles / 256 / 4);
+}
+
+int main() {
+    unsigned v, i;
+    uint32_t pins;
+
+    for (v = 0; v < 256; v++) {
+        pins = 0;
+        for (i = 0; i < 8; i++) {
+            if (v & (1 << i)) {
+                pins |= 1u << channel_pin[i];
+            }
+        }
+        CHECK(((uint32_t)CHANNELS_TO_PORT(v) << LIGHTS_SHIFT) == pins);
+
+        pins = 0;
+        for (i = 0; i < 8; i++) {
+            if (v & (1 << i)) {
+                pins |= 1u << pattern_pin[i];
+            }
+        }
+        lights_write(v);
+        CHECK(mpin == pins);
+        CHECK((mpin & ~(uint32_t)LIGHTS_MASK) == 0);
+    }
+
+    benchmark();
+
+    return TEST_DONE();
+}
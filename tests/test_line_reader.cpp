@@ -0,0 +1,203 @@
+/* The seq.txt tokenizer: line_next() and line_uint() against fgets() and
+   sscanf(), the way the file was parsed before, on the same text. Checks
+   that both give the same fields through buffers of several sizes, covers
+   the awkward lines, and reports host time per S line for each. The host
+   figures only compare the two; the target is a Cortex-M0 without an FPU
+   and its newlib sscanf is slower still. */
+
+#include <time.h>
+#include <string>
+#include "test.h"
+#include "line_reader.h"
+
+#define FIELDS      17      // ticks, then start and stop for 8 channels
+
+word seq_fread(seq_file_t *fp, void *buf, word size) {
+    return fread(buf, 1, size, fp);
+}
+
+static std::string text;
+
+static seq_file_t *open_text(void) {
+    return fmemopen((void *)text.data(), text.size(), "r");
+}
+
+static void make_text(int sequences, int steps) {
+    char line[128];
+    int q, s, f;
+    unsigned v = 12345;
+
+    text.clear();
+    for (q = 0; q < sequences; q++) {
+        sprintf(line, "Q %d %d\n\n", 240 + q, steps);
+        text += line;
+        for (s = 0; s < steps; s++) {
+            text += "S";
+            for (f = 0; f < FIELDS; f++) {
+                v = v * 1103515245 + 12345;
+                sprintf(line, " %u", (v >> 16) % 256);
+                text += line;
+            }
+            text += " \n";
+        }
+        text += "\n";
+    }
+}
+
+/* Every S line's fields, the old way. */
+static unsigned parse_sscanf(unsigned *out) {
+    char line[100];
+    unsigned n = 0;
+    unsigned *v;
+    seq_file_t *fp = open_text();
+
+    while (fgets(line, 100, fp) != NULL) {
+        if (line[0] == 'S') {
+            v = &out[n * FIELDS];
+            sscanf(line, "%*s %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u",
+                    &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8],
+                    &v[9], &v[10], &v[11], &v[12], &v[13], &v[14], &v[15], &v[16]);
+            n++;
+        }
+    }
+    fclose(fp);
+    return n;
+}
+
+/* The same, the way main.cpp parses it now. */
+static unsigned parse_lines(unsigned *out, word size) {
+    static char buf[LINE_BUF_SIZE];
+    sLineReader reader;
+    const char *line;
+    const char *end;
+    word len;
+    unsigned n = 0;
+    unsigned f;
+    seq_file_t *fp = open_text();
+
+    line_open(&reader, fp, buf, size);
+    while ((line = line_next(&reader, &len)) != NULL) {
+        if ((len > 0) && (line[0] == 'S')) {
+            end = line + len;
+            line++;
+            for (f = 0; f < FIELDS; f++) {
+                out[n * FIELDS + f] = 0;
+                line_uint(&line, end, &out[n * FIELDS + f]);
+            }
+            n++;
+        }
+    }
+    fclose(fp);
+    return n;
+}
+
+static void test_same_fields(void) {
+    static const word sizes[] = {LINE_BUF_SIZE, 200, 80};
+    unsigned *want;
+    unsigned *got;
+    unsigned n;
+    unsigned i;
+
+    make_text(4, 50);
+    want = new unsigned[200 * FIELDS];
+    got = new unsigned[200 * FIELDS];
+    n = parse_sscanf(want);
+    CHECK(n == 200);
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        memset(got, 0xFF, 200 * FIELDS * sizeof(unsigned));
+        CHECK(parse_lines(got, sizes[i]) == n);
+        CHECK(memcmp(got, want, n * FIELDS * sizeof(unsigned)) == 0);
+    }
+    delete[] want;
+    delete[] got;
+}
+
+static void test_awkward_lines(void) {
+    char buf[16];
+    sLineReader reader;
+    seq_file_t *fp;
+    const char *line;
+    const char *end;
+    word len;
+    unsigned v;
+
+    // CRLF, a blank line, tabs, a missing field and no '\n' at the end
+    text = "Q 7 2\r\n\nS\t1  22\r\nS 3";
+    fp = open_text();
+    line_open(&reader, fp, buf, sizeof(buf));
+
+    line = line_next(&reader, &len);
+    CHECK((line != NULL) && (len == 6) && (line[0] == 'Q'));
+    end = line + len;
+    line++;
+    CHECK(line_uint(&line, end, &v) && (v == 7));
+    CHECK(line_uint(&line, end, &v) && (v == 2));
+    CHECK(!line_uint(&line, end, &v));      // just the '\r' left
+
+    line = line_next(&reader, &len);
+    CHECK((line != NULL) && (len == 0));
+
+    line = line_next(&reader, &len);
+    CHECK((line != NULL) && (len == 8));
+    end = line + len;
+    line++;
+    CHECK(line_uint(&line, end, &v) && (v == 1));
+    CHECK(line_uint(&line, end, &v) && (v == 22));
+    CHECK(!line_uint(&line, end, &v));
+
+    line = line_next(&reader, &len);
+    CHECK((line != NULL) && (len == 3) && (memcmp(line, "S 3", 3) == 0));
+    CHECK(line_next(&reader, &len) == NULL);
+    fclose(fp);
+
+    // a line longer than the buffer comes out in buffer sized pieces
+    text = "0123456789abcdefghij\nS 5\n";
+    fp = open_text();
+    line_open(&reader, fp, buf, sizeof(buf));
+    line = line_next(&reader, &len);
+    CHECK((line != NULL) && (len == sizeof(buf)) && (memcmp(line, "0123456789abcdef", 16) == 0));
+    line = line_next(&reader, &len);
+    CHECK((line != NULL) && (len == 4) && (memcmp(line, "ghij", 4) == 0));
+    line = line_next(&reader, &len);
+    CHECK((line != NULL) && (len == 3));
+    CHECK(line_next(&reader, &len) == NULL);
+    fclose(fp);
+}
+
+static double per_line_us(clock_t ticks, unsigned lines) {
+    return (double)ticks * 1000000 / CLOCKS_PER_SEC / lines;
+}
+
+static void bench(void) {
+    unsigned *out;
+    unsigned n = 0;
+    unsigned rep;
+    clock_t t0, t_old, t_new;
+
+    make_text(16, 200);
+    out = new unsigned[16 * 200 * FIELDS];
+
+    t0 = clock();
+    for (rep = 0; rep < 20; rep++) {
+        n = parse_sscanf(out);
+    }
+    t_old = clock() - t0;
+
+    t0 = clock();
+    for (rep = 0; rep < 20; rep++) {
+        CHECK(parse_lines(out, LINE_BUF_SIZE) == n);
+    }
+    t_new = clock() - t0;
+
+    printf("  %u S lines, %u bytes of text\n", n, (unsigned)text.size());
+    printf("  fgets + sscanf:        %.3f us/line\n", per_line_us(t_old, n * 20));
+    printf("  line_next + line_uint: %.3f us/line\n", per_line_us(t_new, n * 20));
+    delete[] out;
+}
+
+int main(void) {
+    test_same_fields();
+    test_awkward_lines();
+    bench();
+    return TEST_DONE();
+}
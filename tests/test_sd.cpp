@@ -0,0 +1,148 @@
+/* SDFileSystem against the simulated card: sector reads come back intact,
+   a benchmark of CMD17 per sector against one CMD18 for the run, in SPI
+   bytes per sector and sectors per second of simulated bus time, and how
+   the transfer clock reacts to data CRC errors. */
+
+#include "test.h"
+#include "SDFileSystem/SDFileSystem.h"
+#include "sd_card.h"
+
+#define RUN     64          // sectors read by each benchmark pass
+
+class TestSD : public SDFileSystem {
+public:
+    TestSD() : SDFileSystem(1, 2, 3, -1, "sd") {}
+    uint32_t sck(void) const { return _transfer_sck; }
+};
+
+static uint8_t buffer[RUN * 512];
+
+static bool intact(uint32_t sector, uint32_t count) {
+    uint32_t s;
+    int i;
+
+    for (s = 0; s < count; s++) {
+        for (i = 0; i < 512; i++) {
+            if (buffer[s * 512 + i] != sd_card_data(sector + s, i)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void test_init(TestSD &sd) {
+    CHECK(sd.disk_initialize() == 0);
+    CHECK(sd.init_report().result == SD_INIT_OK);
+    CHECK(sd.disk_sectors() == SD_CARD_SECTORS);
+    CHECK(sd.sck() == 24000000);        // PCLK / 2, the fastest the SSP can do under 25 MHz
+    CHECK(sd_card_sck == 24000000);
+}
+
+/* Reads RUN sectors per_call at a time, returns the simulated time in us. */
+static uint32_t bench(TestSD &sd, uint32_t per_call, uint32_t *bytes) {
+    uint64_t start = stub_now_us;
+    uint32_t first = 1000;
+    uint32_t s;
+
+    memset(buffer, 0, sizeof(buffer));
+    sd_card_bytes = 0;
+    for (s = 0; s < RUN; s += per_call) {
+        CHECK(sd.disk_read(&buffer[s * 512], first + s, per_call) == 0);
+    }
+    CHECK(intact(first, RUN));
+    *bytes = sd_card_bytes;
+    return (uint32_t)(stub_now_us - start);
+}
+
+static void test_reads(TestSD &sd) {
+    uint32_t bytes1, bytesN;
+    uint32_t us1, usN;
+
+    us1 = bench(sd, 1, &bytes1);
+    usN = bench(sd, RUN, &bytesN);
+
+    printf("  SCK %u Hz, access %u us, next block %u us\n", (unsigned)sd_card_sck, SD_CARD_ACCESS_US, SD_CARD_NEXT_US);
+    printf("  CMD17 x %u: %u SPI bytes/sector, %u sectors/s\n", RUN,
+            (unsigned)(bytes1 / RUN), (unsigned)((uint64_t)RUN * 1000000 / us1));
+    printf("  CMD18 x 1:  %u SPI bytes/sector, %u sectors/s\n",
+            (unsigned)(bytesN / RUN), (unsigned)((uint64_t)RUN * 1000000 / usN));
+
+    CHECK(bytesN < bytes1);
+    CHECK(usN * 2 < us1);               // the access latency is paid once instead of per sector
+
+    // a run starting at the last sector but one, and the single sector at the end
+    CHECK(sd.disk_read(buffer, SD_CARD_SECTORS - 2, 2) == 0);
+    CHECK(intact(SD_CARD_SECTORS - 2, 2));
+    CHECK(sd.disk_read(buffer, SD_CARD_SECTORS - 1, 1) == 0);
+    CHECK(intact(SD_CARD_SECTORS - 1, 1));
+
+    // past the end the card refuses, and the driver gives up without slowing down
+    CHECK(sd.disk_read(buffer, SD_CARD_SECTORS, 2) != 0);
+    CHECK(sd.disk_read(buffer, SD_CARD_SECTORS, 1) != 0);
+    CHECK(sd.sck() == 24000000);
+}
+
+/* Occasional CRC errors are retried at the same clock. */
+static void test_glitches(TestSD &sd) {
+    uint32_t count;
+
+    for (count = 1; count <= 8; count += 7) {
+        sd_card_corrupt(1);
+        memset(buffer, 0, sizeof(buffer));
+        CHECK(sd.disk_read(buffer, 50, count) == 0);
+        CHECK(intact(50, count));
+
+        sd_card_corrupt(2);
+        memset(buffer, 0, sizeof(buffer));
+        CHECK(sd.disk_read(buffer, 60, count) == 0);
+        CHECK(intact(60, count));
+        CHECK(sd.sck() == 24000000);
+    }
+}
+
+/* A card that garbles everything above 6 MHz: the driver halves SCK once
+   each block has failed SD_READ_RETRIES times, and the data is right. */
+static void test_step_down(TestSD &sd) {
+    sd_card_max_sck(6000000);
+    memset(buffer, 0, sizeof(buffer));
+    CHECK(sd.disk_read(buffer, 70, 8) == 0);
+    CHECK(intact(70, 8));
+    CHECK(sd.sck() == 6000000);
+
+    // and it stays there
+    sd_card_bytes = 0;
+    CHECK(sd.disk_read(buffer, 80, 1) == 0);
+    CHECK(sd_card_bytes < 1000);
+}
+
+/* The same card from power up: the read-back check settles on 6 MHz. */
+static void test_init_step_down(void) {
+    TestSD sd;
+
+    sd_card_reset();
+    sd_card_max_sck(6000000);
+    CHECK(sd.disk_initialize() == 0);
+    CHECK(sd.sck() == 6000000);
+    CHECK(sd.disk_read(buffer, 90, 4) == 0);
+    CHECK(intact(90, 4));
+
+    // a card that can't be read at any clock fails rather than hanging
+    sd_card_reset();
+    sd_card_max_sck(150000);             // only the 100 kHz init clock works
+    TestSD bad;
+    CHECK(bad.disk_initialize() != 0);
+    CHECK(bad.init_report().result == SD_INIT_SCK);
+}
+
+int main(void) {
+    TestSD sd;
+
+    sd_card_reset();
+    test_init(sd);
+    test_reads(sd);
+    test_glitches(sd);
+    test_step_down(sd);
+    test_init_step_down();
+    return TEST_DONE();
+}
@@ -0,0 +1,112 @@
+/* seq_pack.cpp: what each kind of channel costs once coded against the step
+   before, and random sequences read back through the cursor forwards, again,
+   back to the start and after a jump. */
+
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "seq_pack.h"
+
+#define STEPS   200
+
+static sDimStep steps[STEPS];
+static byte packed[STEPS * SEQ_PACK_MAX];
+
+static void set(sDimStep *step, byte ticks, byte start, byte stop) {
+    step->ticks = ticks;
+    for (int i = 0; i < 8; i++) {
+        step->Chan[i].start = start;
+        step->Chan[i].stop = stop;
+    }
+}
+
+static bool same(const sDimStep *a, const sDimStep *b) {
+    return (a != NULL) && (b != NULL) && (memcmp(a, b, sizeof(sDimStep)) == 0);
+}
+
+static void test_sizes(void) {
+    sDimStep prev;
+    sDimStep step;
+
+    set(&step, 10, 0, 0);
+    CHECK(seq_pack_size(&step, NULL) == 3);             // off from the start
+    set(&step, 10, 0, 255);
+    CHECK(seq_pack_size(&step, NULL) == 3 + 8);         // ramping up from off
+    set(&step, 10, 255, 0);
+    CHECK(seq_pack_size(&step, NULL) == 3 + 16);        // the worst case
+    CHECK(seq_pack(packed, &step, NULL) == SEQ_PACK_MAX);
+
+    set(&prev, 10, 0, 128);
+    set(&step, 10, 128, 128);
+    CHECK(seq_pack_size(&step, &prev) == 3);            // holding where the ramp ended
+    set(&step, 10, 128, 0);
+    CHECK(seq_pack_size(&step, &prev) == 3 + 8);        // ramping on from there
+    set(&step, 10, 64, 64);
+    CHECK(seq_pack_size(&step, &prev) == 3 + 8);        // jumping to a new level
+
+    step.Chan[3].start = 128;                           // one channel of each
+    step.Chan[3].stop = 128;
+    step.Chan[5].start = 128;
+    step.Chan[5].stop = 200;
+    step.Chan[6].start = 1;
+    step.Chan[6].stop = 2;
+    CHECK(seq_pack_size(&step, &prev) == 3 + 5 + 0 + 1 + 2);
+    CHECK(seq_pack(packed, &step, &prev) == 3 + 5 + 0 + 1 + 2);
+}
+
+/* Levels that mostly carry on from the step before, as a sequence would. */
+static word make_sequence(void) {
+    word size = 0;
+
+    srand(33);
+    for (int s = 0; s < STEPS; s++) {
+        steps[s].ticks = rand();
+        for (int i = 0; i < 8; i++) {
+            sDimChanStep *ch = &steps[s].Chan[i];
+            byte from = (s > 0) ? steps[s - 1].Chan[i].stop : 0;
+
+            switch (rand() % 4) {
+            case 0:  ch->start = from;   ch->stop = from;   break;
+            case 1:  ch->start = from;   ch->stop = rand(); break;
+            case 2:  ch->start = rand(); ch->stop = rand(); break;
+            default: ch->start = rand(); ch->stop = ch->start; break;
+            }
+        }
+        size += seq_pack(&packed[size], &steps[s], (s > 0) ? &steps[s - 1] : NULL);
+    }
+    return size;
+}
+
+static void test_cursor(void) {
+    sSeqPackCursor cursor;
+    word size;
+    word total = 0;
+
+    size = make_sequence();
+    for (int s = 0; s < STEPS; s++)
+        total += seq_pack_size(&steps[s], (s > 0) ? &steps[s - 1] : NULL);
+    CHECK(size == total);
+    CHECK(size < STEPS * sizeof(sDimStep));
+
+    seq_pack_open(&cursor, packed, STEPS);
+    for (int s = 0; s < STEPS; s++) {
+        CHECK(same(seq_pack_step(&cursor, s), &steps[s]));
+        CHECK(same(seq_pack_step(&cursor, s), &steps[s]));      // asked again in the same step
+    }
+    CHECK(cursor.next == packed + size);
+    CHECK(seq_pack_step(&cursor, STEPS) == NULL);
+
+    CHECK(same(seq_pack_step(&cursor, 0), &steps[0]));          // round again from the start
+    CHECK(same(seq_pack_step(&cursor, 1), &steps[1]));
+    CHECK(same(seq_pack_step(&cursor, 150), &steps[150]));      // a jump walks there
+    CHECK(same(seq_pack_step(&cursor, 20), &steps[20]));        // and so does one back
+
+    seq_pack_open(&cursor, packed, 0);
+    CHECK(seq_pack_step(&cursor, 0) == NULL);
+}
+
+int main(void) {
+    test_sizes();
+    test_cursor();
+    return TEST_DONE();
+}
@@ -0,0 +1,159 @@
+/* seq_txt.cpp: the shipped seq.txt against a plain fgets() and sscanf()
+   parse of it, then the awkward lines. Every parse goes through a
+   LINE_BUF_SIZE buffer with guard bytes after it, so a reader opened on the
+   wrong size either splits the S lines or runs into the guard. */
+
+#include <string.h>
+#include <string>
+#include <vector>
+#include "test.h"
+#include "seq_txt.h"
+#include "line_reader.h"
+
+#define GUARD   16
+
+word seq_fread(seq_file_t *fp, void *buf, word size) {
+    return fread(buf, 1, size, fp);
+}
+
+byte seq_fseek(seq_file_t *fp, dword offset) {
+    return fseek(fp, offset, SEEK_SET) == 0;
+}
+
+typedef struct {
+    unsigned int sequence;
+    unsigned int steps;
+    std::vector<sDimStep> step;
+    byte finished;
+    } sSeq;
+
+static std::vector<sSeq> got;
+
+static void got_start(unsigned int sequence, unsigned int steps) {
+    sSeq seq;
+
+    seq.sequence = sequence;
+    seq.steps = steps;
+    seq.finished = FALSE;
+    got.push_back(seq);
+}
+
+static void got_step(const sDimStep *ptrStep) {
+    got.back().step.push_back(*ptrStep);
+}
+
+static void got_finish(void) {
+    got.back().finished = TRUE;
+}
+
+static const sSeqTxtSink sink = { got_start, got_step, got_finish };
+
+static void parse(seq_file_t *fp) {
+    char buf[LINE_BUF_SIZE + GUARD];
+    int i;
+
+    memset(buf + LINE_BUF_SIZE, 0x5A, GUARD);
+    got.clear();
+    seq_txt_parse(fp, buf, &sink);
+    for (i = 0; i < GUARD; i++) {
+        CHECK(buf[LINE_BUF_SIZE + i] == 0x5A);
+    }
+}
+
+static void parse_text(const std::string &text) {
+    seq_file_t *fp = fmemopen((void *)text.data(), text.size(), "r");
+
+    parse(fp);
+    fclose(fp);
+}
+
+static bool step_is(const sDimStep *step, const unsigned *v) {
+    int i;
+
+    if (step->ticks != (v[0] & 0xFF)) {
+        return false;
+    }
+    for (i = 0; i < 8; i++) {
+        if ((step->Chan[i].start != (v[1 + 2 * i] & 0xFF)) || (step->Chan[i].stop != (v[2 + 2 * i] & 0xFF))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* The whole of seq.txt, as sscanf() sees it. */
+static void test_seq_txt(void) {
+    char line[100];
+    unsigned v[17];
+    unsigned q = 0;
+    unsigned s = 0;
+    unsigned sequence, steps;
+    seq_file_t *fp = fopen("../seq.txt", "r");
+
+    CHECK(fp != NULL);
+    if (fp == NULL) {
+        return;
+    }
+    parse(fp);
+    rewind(fp);
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (sscanf(line, "Q %u %u", &sequence, &steps) == 2) {
+            CHECK(q < got.size());
+            if (q >= got.size()) {
+                break;
+            }
+            CHECK((got[q].sequence == sequence) && (got[q].steps == steps) && got[q].finished);
+            q++;
+            s = 0;
+        }
+        else if (line[0] == 'S') {
+            sscanf(line, "S %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u",
+                    &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8],
+                    &v[9], &v[10], &v[11], &v[12], &v[13], &v[14], &v[15], &v[16]);
+            CHECK(s < got[q - 1].step.size());
+            CHECK(step_is(&got[q - 1].step[s], v));
+            s++;
+        }
+    }
+    CHECK(q == got.size());
+    CHECK(q == 16);
+    fclose(fp);
+}
+
+static void test_awkward(void) {
+    static const unsigned full[17] = {300, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 256};
+    static const unsigned part[17] = {7, 8};
+    static const unsigned none[17] = {0};
+    std::string text;
+    int n;
+
+    // steps before the first Q line go nowhere, the rest land where they belong
+    parse_text("S 1 2 3\nQ 241 3\r\n\r\nS 300 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 256\r\n"
+               "S\t7  8\nS\n\nQ 7\n\nS 1");
+    CHECK(got.size() == 2);
+    CHECK((got[0].sequence == 241) && (got[0].steps == 3) && got[0].finished);
+    CHECK(got[0].step.size() == 3);
+    CHECK(step_is(&got[0].step[0], full));      // masked to a byte, like the old casts
+    CHECK(step_is(&got[0].step[1], part));      // missing fields are 0
+    CHECK(step_is(&got[0].step[2], none));
+    CHECK((got[1].sequence == 7) && (got[1].steps == 0) && got[1].finished);
+    CHECK(got[1].step.size() == 1);             // the last line without its '\n'
+
+    // enough steps to cross the end of the buffer many times over
+    text = "Q 250 200\n";
+    for (n = 0; n < 200; n++) {
+        text += "S 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 255\n";
+    }
+    parse_text(text);
+    CHECK((got.size() == 1) && (got[0].step.size() == 200));
+    CHECK((got[0].step[0].Chan[7].stop == 255) && (got[0].step[199].Chan[7].stop == 255));
+
+    parse_text("");
+    CHECK(got.empty());
+}
+
+int main(void) {
+    test_seq_txt();
+    test_awkward();
+    return TEST_DONE();
+}
@@ -0,0 +1,117 @@
+/* ser_fmt.cpp against the C library's vsnprintf() on the conversions it
+   understands, mbed's own error messages among them, and what it does with
+   the ones it doesn't. Also reports host time per message for each; the
+   figures only compare the two. */
+
+#include <time.h>
+#include <limits.h>
+#include <string>
+#include <deque>
+#include "test.h"
+#include "ser_fmt.h"
+
+#define RUNS    100000
+
+extern std::deque<unsigned char> stub_tx;
+
+static RawSerial port(0, 0);
+
+static std::string sent(void) {
+    std::string s(stub_tx.begin(), stub_tx.end());
+
+    stub_tx.clear();
+    return s;
+}
+
+/* TRUE if ser_vprintf() writes what vsnprintf() would. */
+static bool same(const char *format, ...) {
+    char want[256];
+    va_list args;
+    va_list copy;
+
+    va_start(args, format);
+    va_copy(copy, args);
+    vsnprintf(want, sizeof(want), format, args);
+    ser_vprintf(&port, format, copy);
+    va_end(copy);
+    va_end(args);
+    if (sent() != want) {
+        printf("  \"%s\" gave something else than \"%s\"\n", format, want);
+        return false;
+    }
+    return true;
+}
+
+static void test_conversions(void) {
+    CHECK(same("plain text\r\n"));
+    CHECK(same("%d %d %d %i", 0, -1, INT_MIN, INT_MAX));
+    CHECK(same("%u %x %X %o", UINT_MAX, 0xBEEFu, 0xBEEFu, 8u));
+    CHECK(same("%ld %lu %lx", LONG_MIN, ULONG_MAX, 0x12345678UL));
+    CHECK(same("%lld %llu %llx", LLONG_MIN, ULLONG_MAX, 0x123456789ABCDEFULL));
+    CHECK(same("%hd %hhu %zu %jd", (short)-5, (unsigned char)200, (size_t)77, (intmax_t)-9));
+    CHECK(same("[%5d] [%-5d] [%05d] [%-05d] [%05d]", 42, 42, 42, 42, -42));
+    CHECK(same("[%*d] [%-*d] [%*d]", 6, 7, 6, 7, -6, 7));
+    CHECK(same("[%08lx] [%02x] [%#x] [%+d] [% d]", 0xABCUL, 0xE, 0x10u, 3, 3));
+    CHECK(same("[%s] [%8s] [%-8s] [%.3s] [%.*s]", "abc", "abc", "abc", "abcdef", 2, "abcdef"));
+    CHECK(same("[%#o] [%#X] [%#x] [%+5d] [%-+5d] [%+05d] [% +d]", 8u, 0xABu, 0u, 12, 12, -12, 1));
+    CHECK(same("%c%c%% %s", 'o', 'k', ""));
+
+    // mbed's own, as they reach mbed_error_vfprintf()
+    CHECK(same("mbed assertation failed: %s, file: %s, line %d \n", "x < 5", "main.cpp", 123));
+    CHECK(same("Couldn't create %s in FATFileSystem::FATFileSystem\n", "sd"));
+    CHECK(same("Data error token %02x\n", 0x0B));
+    CHECK(same("Stream obj failure, errno=%d\r\n", -5));
+}
+
+/* Conversions it doesn't do still take their argument, so everything after
+   them comes out right. */
+static void test_unknown(void) {
+    ser_printf(&port, "%f then %d", 1.5, 7);
+    CHECK(sent() == "%f then 7");
+    ser_printf(&port, "%8.3Lf then %s", (long double)2.5, "next");
+    CHECK(sent() == "%8.3Lf then next");
+    ser_printf(&port, "%lq then %u", 1L, 9u);
+    CHECK(sent() == "%lq then 9");
+    ser_printf(&port, "%p", (void *)0x1234);
+    CHECK(sent() == "0x1234");
+    ser_printf(&port, "cut short %");
+    CHECK(sent() == "cut short ");
+    ser_printf(&port, "cut short %08l");
+    CHECK(sent() == "cut short ");
+    ser_printf(&port, "%s", (const char *)NULL);
+    CHECK(sent() == "(null)");
+}
+
+static void test_time(void) {
+    static const char *format = "SD %d: CMD0 %lu CMD8 %lu ACMD41 %lu CSD %lu mount %lu us\r\n";
+    char buf[128];
+    clock_t t0;
+    double ser_us, lib_us;
+    int n;
+
+    t0 = clock();
+    for (n = 0; n < RUNS; n++) {
+        ser_printf(&port, format, 0, 1200UL, 340UL, 182000UL, 2100UL, 9800UL);
+        stub_tx.clear();
+    }
+    ser_us = (double)(clock() - t0) * 1000000 / CLOCKS_PER_SEC / RUNS;
+
+    t0 = clock();
+    for (n = 0; n < RUNS; n++) {
+        snprintf(buf, sizeof(buf), format, 0, 1200UL, 340UL, 182000UL, 2100UL, 9800UL);
+        for (const char *p = buf; *p != '\0'; p++) {
+            port.putc(*p);
+        }
+        stub_tx.clear();
+    }
+    lib_us = (double)(clock() - t0) * 1000000 / CLOCKS_PER_SEC / RUNS;
+
+    printf("  the SD report line: ser_printf %.2f us, snprintf %.2f us on the host\n", ser_us, lib_us);
+}
+
+int main(void) {
+    test_conversions();
+    test_unknown();
+    test_time();
+    return TEST_DONE();
+}
@@ -0,0 +1,208 @@
+/* The LPC11U SPI HAL against a cycle model of the SSP: spi_master_write()
+   one byte at a time, the way the SD driver moved data before, against
+   spi_master_block_write(). Reports CPU cycles per byte and how busy the
+   bus was, and checks the receive FIFO never overruns however slow the CPU
+   is next to SCK. */
+
+#include <deque>
+#include "test.h"
+
+/* spi_init() makes a pointer out of the SSP's base address. */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wint-to-pointer-cast"
+#include "mbed-dev/targets/TARGET_NXP/TARGET_LPC11UXX/spi_api.c"
+#pragma GCC diagnostic pop
+
+#define SSP_FIFO        8       // entries in each of the TX and RX FIFOs
+#define SSP_ACCESS      4       // cycles per SSP register access, including the loop around it
+#define BLOCK           512
+
+LPC_SYSCON_Type stub_syscon;
+uint32_t SystemCoreClock = 48000000;
+
+const PinMap PinMap_SPI_SCLK[] = {{NC, 0, 0}};
+const PinMap PinMap_SPI_MOSI[] = {{NC, 0, 0}};
+const PinMap PinMap_SPI_MISO[] = {{NC, 0, 0}};
+const PinMap PinMap_SPI_SSEL[] = {{NC, 0, 0}};
+
+uint32_t pinmap_peripheral(PinName pin, const PinMap *map) { return 0; }
+uint32_t pinmap_merge(uint32_t a, uint32_t b) { return a; }
+void pinmap_pinout(PinName pin, const PinMap *map) {}
+
+/* The SSP: a TX FIFO feeding a shifter feeding an RX FIFO. Time is in CPU
+   cycles and only moves on register accesses. */
+static uint64_t now;
+static uint64_t shift_done;             /* When the byte in the shifter is done. */
+static int shifting;
+static std::deque<uint8_t> tx_fifo;
+static std::deque<uint8_t> rx_fifo;
+static uint32_t shifted;                /* Bytes that have crossed the bus. */
+static int access_cycles;
+static int overruns;
+static int lost;
+static int underruns;
+
+static LPC_SSPx_Type ssp;
+
+static uint32_t byte_cycles(void) {
+    return 8 * ssp.CPSR * (((ssp.CR0 >> 8) & 0xFF) + 1);
+}
+
+static uint8_t miso(uint32_t n) {
+    return (uint8_t)(n * 5 + 1);
+}
+
+static void ssp_run(void) {
+    now += access_cycles;
+    while (shifting && (shift_done <= now)) {
+        if (rx_fifo.size() >= SSP_FIFO) {
+            overruns++;
+        }
+        else {
+            rx_fifo.push_back(miso(shifted));
+        }
+        shifted++;
+        shifting = 0;
+        if (!tx_fifo.empty()) {
+            tx_fifo.pop_front();
+            shifting = 1;
+            shift_done += byte_cycles();
+        }
+    }
+}
+
+void ssp_dr_write(uint32_t value) {
+    ssp_run();
+    if (tx_fifo.size() >= SSP_FIFO) {
+        lost++;
+        return;
+    }
+    tx_fifo.push_back(value);
+    if (!shifting) {
+        tx_fifo.pop_front();
+        shifting = 1;
+        shift_done = now + byte_cycles();
+    }
+}
+
+uint32_t ssp_dr_read(void) {
+    uint8_t value;
+
+    ssp_run();
+    if (rx_fifo.empty()) {
+        underruns++;
+        return 0;
+    }
+    value = rx_fifo.front();
+    rx_fifo.pop_front();
+    return value;
+}
+
+uint32_t ssp_sr_read(void) {
+    ssp_run();
+    return ((tx_fifo.size() < SSP_FIFO) ? (1 << 1) : 0)
+         | (!rx_fifo.empty() ? (1 << 2) : 0)
+         | ((shifting || !tx_fifo.empty()) ? (1 << 4) : 0);
+}
+
+static void ssp_reset(int cycles) {
+    now = 0;
+    shifting = 0;
+    tx_fifo.clear();
+    rx_fifo.clear();
+    shifted = 0;
+    access_cycles = cycles;
+    overruns = 0;
+    lost = 0;
+    underruns = 0;
+}
+
+/* Moves a block one way or the other, returns the cycles it took. */
+static uint32_t transfer(spi_t *obj, bool block, bool reading) {
+    static char tx[BLOCK];
+    static char rx[BLOCK];
+    uint32_t i;
+    bool same = true;
+
+    for (i = 0; i < BLOCK; i++) {
+        tx[i] = (char)i;
+        rx[i] = 0;
+    }
+    ssp_reset(access_cycles);
+    if (block) {
+        if (reading) {
+            spi_master_block_write(obj, NULL, 0, rx, BLOCK, (char)0xFF);
+        }
+        else {
+            spi_master_block_write(obj, tx, BLOCK, NULL, 0, (char)0xFF);
+        }
+    }
+    else {
+        for (i = 0; i < BLOCK; i++) {
+            rx[i] = spi_master_write(obj, reading ? 0xFF : tx[i]);
+        }
+    }
+
+    CHECK(shifted == BLOCK);
+    CHECK(overruns == 0);
+    CHECK(lost == 0);
+    CHECK(underruns == 0);
+    CHECK(rx_fifo.empty());
+    if (reading) {
+        for (i = 0; i < BLOCK; i++) {
+            if ((uint8_t)rx[i] != miso(i)) {
+                same = false;
+            }
+        }
+        CHECK(same);
+    }
+    return (uint32_t)now;
+}
+
+static void test_compare(spi_t *obj) {
+    static const int sck[] = {24000000, 12000000, 6000000, 1000000};
+    uint32_t one, blk;
+    unsigned i;
+
+    access_cycles = SSP_ACCESS;
+    printf("  %u cycles per register access, %u byte block read\n", SSP_ACCESS, BLOCK);
+    for (i = 0; i < sizeof(sck) / sizeof(sck[0]); i++) {
+        spi_frequency(obj, sck[i]);
+        one = transfer(obj, false, true);
+        blk = transfer(obj, true, true);
+        printf("  SCK %8d: byte at a time %5.1f cycles/byte (bus %3u%%), block %5.1f cycles/byte (bus %3u%%)\n",
+                sck[i],
+                (double)one / BLOCK, (unsigned)((uint64_t)BLOCK * byte_cycles() * 100 / one),
+                (double)blk / BLOCK, (unsigned)((uint64_t)BLOCK * byte_cycles() * 100 / blk));
+        CHECK(blk < one);
+        CHECK((uint64_t)BLOCK * byte_cycles() * 100 / blk >= 95);      // the bus hardly ever waits for the CPU
+
+        blk = transfer(obj, true, false);                               // writing is no different
+        CHECK((uint64_t)BLOCK * byte_cycles() * 100 / blk >= 95);
+    }
+}
+
+/* A CPU far slower than the bus still can't overrun the receive FIFO,
+   because no more than a FIFO's worth is ever in flight. */
+static void test_slow_cpu(spi_t *obj) {
+    static const int cycles[] = {1, 7, 40, 300};
+    unsigned i;
+
+    spi_frequency(obj, 24000000);
+    for (i = 0; i < sizeof(cycles) / sizeof(cycles[0]); i++) {
+        access_cycles = cycles[i];
+        transfer(obj, true, true);
+        transfer(obj, true, false);
+    }
+}
+
+int main(void) {
+    spi_t obj;
+
+    obj.spi = &ssp;
+    spi_format(&obj, 8, 0, 0);
+
+    test_compare(&obj);
+    test_slow_cpu(&obj);
+    return TEST_DONE();
+}
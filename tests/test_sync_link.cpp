@@ -0,0 +1,455 @@
+/* The sync link over a stub serial port: command frames looped back into the
+   slave's receive interrupt, the rate negotiation from either end, and the
+   bulk sequence transfer with its resend and timeouts. Also simulates how long a speed change takes to reach a
+   slave: the old "R" and "C <speed>" text lines read by vfnGetLine() and
+   sscanf() in the slave's main loop, against one binary frame decoded by
+   the receive interrupt. The wire time is simulated; the parse times are
+   host figures that only compare the two. */
+
+#include <time.h>
+#include <deque>
+#include <string>
+#include "test.h"
+#include "sync_link.h"
+
+extern std::deque<unsigned char> stub_tx;
+extern std::deque<unsigned char> stub_rx;
+
+static RawSerial port(0, 0);
+
+static void deliver(void) {
+    stub_serial_loopback();
+    stub_serial_rx_irq();
+}
+
+static void drain(void) {
+    sSyncCmd cmd;
+
+    while (sync_get(&cmd));
+}
+
+static void test_round_trip(void) {
+    static const byte ops[] = {SYNC_RESTART, SYNC_STEP, SYNC_PROBE, SYNC_CHECK, SYNC_ACK, SYNC_QUERY, SYNC_NAK, SYNC_GO, SYNC_DONE};
+    static const word values[] = {0, 1, 0x00A5, 0xA5A5, 0x7FFF, 0xFFFF};
+    sSyncCmd cmd;
+    unsigned i, j;
+
+    for (i = 0; i < sizeof(ops); i++) {
+        for (j = 0; j < sizeof(values) / sizeof(values[0]); j++) {
+            sync_send(ops[i], values[j], values[sizeof(values) / sizeof(values[0]) - 1 - j]);
+            CHECK(stub_tx.size() == 7);
+            CHECK(stub_tx.front() == SYNC_BYTE);
+            deliver();
+            CHECK(sync_get(&cmd));
+            CHECK(cmd.op == ops[i]);
+            CHECK(cmd.step == values[j]);
+            CHECK(cmd.speed == values[sizeof(values) / sizeof(values[0]) - 1 - j]);
+            CHECK(!sync_get(&cmd));
+        }
+    }
+}
+
+/* Every single bit error in a frame is caught by the CRC-8. */
+static void test_corruption(void) {
+    std::deque<unsigned char> frame;
+    sSyncCmd cmd;
+    unsigned byte_no, bit;
+
+    sync_send(SYNC_STEP, 1234, 567);
+    frame = stub_tx;
+    stub_tx.clear();
+    for (byte_no = 1; byte_no < frame.size(); byte_no++) {
+        for (bit = 0; bit < 8; bit++) {
+            stub_tx = frame;
+            stub_tx[byte_no] ^= 1 << bit;
+            deliver();
+            CHECK(!sync_get(&cmd));
+            drain();
+        }
+    }
+}
+
+/* Noise on the line, with and without SYNC_BYTE in it, costs at most the
+   frame it overlaps; the one after it always gets through. */
+static void test_resync(void) {
+    sSyncCmd cmd;
+    unsigned noise, len;
+
+    for (noise = 0; noise < 3; noise++) {
+        for (len = 1; len < 7; len++) {
+            unsigned k;
+
+            for (k = 0; k < len; k++) {
+                stub_tx.push_back(noise == 0 ? 0x00 : (noise == 1 ? SYNC_BYTE : (k & 1 ? 0xFF : SYNC_BYTE)));
+            }
+            sync_send(SYNC_STEP, 1, 2);
+            sync_send(SYNC_STEP, 3, 4);
+            deliver();
+            CHECK(sync_get(&cmd));
+            if (cmd.step == 1) {
+                CHECK(sync_get(&cmd));
+            }
+            CHECK(cmd.op == SYNC_STEP);
+            CHECK(cmd.step == 3);
+            CHECK(cmd.speed == 4);
+            CHECK(!sync_get(&cmd));
+        }
+    }
+}
+
+/* A cut-off frame followed by a good one: the good one is lost with it, the
+   next is decoded. */
+static void test_truncated(void) {
+    sSyncCmd cmd;
+
+    sync_send(SYNC_STEP, 7, 8);
+    stub_tx.pop_back();
+    stub_tx.pop_back();
+    sync_send(SYNC_STEP, 9, 10);
+    sync_send(SYNC_STEP, 11, 12);
+    deliver();
+    CHECK(sync_get(&cmd));
+    CHECK(cmd.step == 11);
+    CHECK(!sync_get(&cmd));
+}
+
+/* The mailbox holds SYNC_MAILBOX - 1 commands and drops the newest after that. */
+static void test_mailbox_full(void) {
+    sSyncCmd cmd;
+    word i;
+
+    for (i = 0; i < SYNC_MAILBOX + 2; i++) {
+        sync_send(SYNC_STEP, i, 0);
+    }
+    deliver();
+    for (i = 0; i < SYNC_MAILBOX - 1; i++) {
+        CHECK(sync_get(&cmd));
+        CHECK(cmd.step == i);
+    }
+    CHECK(!sync_get(&cmd));
+
+    sync_send(SYNC_STEP, 100, 0);       // and it recovers once emptied
+    deliver();
+    CHECK(sync_get(&cmd));
+    CHECK(cmd.step == 100);
+}
+
+/* Opcodes of the whole frames sent so far, which are then cleared. */
+static std::string sent_ops(void) {
+    std::string ops;
+    unsigned i;
+
+    for (i = 0; i + 7 <= stub_tx.size(); i += 7) {
+        ops += (char)stub_tx[i + 1];
+    }
+    stub_tx.clear();
+    return ops;
+}
+
+/* Master: with no slave answering, it never leaves 9600 baud. With one that
+   ACKs the first CHECK and then falls silent, it goes no further than that. */
+static void test_negotiate_master(void) {
+    CHECK(sync_negotiate_master() == 9600);
+    CHECK(stub_baud == 9600);
+    CHECK(sent_ops() == "PKQDDD");
+
+    stub_serial_later(0x55, 2 * SYNC_SETTLE_MS * 1000);     // an ACK during the CHECK
+    CHECK(sync_negotiate_master() == 19200);
+    CHECK(stub_baud == 19200);
+    CHECK(sent_ops() == "PKQGGGPKQDDD");
+}
+
+/* Slave: the CHECK it hears is ACKed, and it follows the master's GO and DONE. */
+static void test_negotiate_slave(void) {
+    sync_send(SYNC_PROBE, 1, 0);
+    sync_send(SYNC_CHECK, 1, 0);
+    sync_send(SYNC_QUERY, 1, 0);
+    sync_send(SYNC_GO, 1, 0);
+    sync_send(SYNC_DONE, 1, 0);
+    stub_serial_loopback();
+    CHECK(sync_negotiate_slave() == 19200);
+    CHECK(stub_baud == 19200);
+    CHECK(sent_ops() == "A");
+
+    sync_send(SYNC_PROBE, 2, 0);        // a missed CHECK is NAKed, not ACKed
+    sync_send(SYNC_CHECK, 3, 0);
+    sync_send(SYNC_QUERY, 2, 0);
+    sync_send(SYNC_DONE, 0, 0);
+    stub_serial_loopback();
+    CHECK(sync_negotiate_slave() == 9600);
+    CHECK(stub_baud == 9600);
+    CHECK(sent_ops() == "N");
+}
+
+static void make_step(sDimStep *step, byte n) {
+    byte c;
+
+    step->ticks = n + 1;
+    for (c = 0; c < 8; c++) {
+        step->Chan[c].start = (byte)(n * 8 + c);
+        step->Chan[c].stop = (byte)(255 - n * 8 - c);
+    }
+}
+
+/* Master: one pass of three sequences, the middle one long enough to span
+   more than a FIFO's worth of bytes. */
+static void send_pass(void) {
+    static const word counts[] = {2, 20, 1};
+    sDimStep step;
+    byte seq;
+    word i;
+
+    for (seq = 0; seq < 3; seq++) {
+        sync_bulk_start(seq, counts[seq]);
+        for (i = 0; i < counts[seq]; i++) {
+            make_step(&step, i);
+            sync_bulk_step(&step);
+        }
+        sync_bulk_finish();
+    }
+}
+
+/* Slave: read one block, TRUE if it checks out and every step is what was sent. */
+static byte read_block(byte *seq, word *count) {
+    sDimStep step;
+    sDimStep want;
+    byte same = TRUE;
+    word i;
+
+    if (sync_bulk_header(seq, count) != BULK_BLOCK) {
+        return FALSE;
+    }
+    for (i = 0; i < *count; i++) {
+        sync_bulk_read(&step, 1);
+        make_step(&want, i);
+        if (memcmp(&step, &want, sizeof(step)) != 0) {
+            same = FALSE;
+        }
+    }
+    return sync_bulk_check() && same;
+}
+
+static void test_bulk_clean(void) {
+    byte seq;
+    word count;
+
+    send_pass();
+    CHECK(!sync_bulk_end(FALSE));       // nobody objects, the transfer closes
+    stub_serial_loopback();
+
+    CHECK(read_block(&seq, &count) && (seq == 0) && (count == 2));
+    CHECK(read_block(&seq, &count) && (seq == 1) && (count == 20));
+    CHECK(read_block(&seq, &count) && (seq == 2) && (count == 1));
+    CHECK(sync_bulk_header(&seq, &count) == BULK_END_PASS);
+    CHECK(sync_bulk_header(&seq, &count) == BULK_END_CLOSE);
+    CHECK(stub_rx.empty());
+}
+
+/* A block announced longer than the steps it was given is made up with the
+   last levels held for one tick, never with 0 tick steps. */
+static void test_bulk_short(void) {
+    sDimStep step;
+    sDimStep last;
+    byte seq;
+    word count;
+    word i;
+
+    sync_bulk_start(5, 4);
+    make_step(&last, 3);
+    sync_bulk_step(&last);
+    sync_bulk_finish();
+    sync_bulk_start(6, 2);
+    sync_bulk_finish();
+    stub_serial_loopback();
+
+    CHECK((sync_bulk_header(&seq, &count) == BULK_BLOCK) && (seq == 5) && (count == 4));
+    sync_bulk_read(&step, 1);
+    CHECK(memcmp(&step, &last, sizeof(step)) == 0);
+    for (i = 1; i < count; i++) {
+        sync_bulk_read(&step, 1);
+        CHECK(step.ticks == 1);
+        CHECK((step.Chan[0].start == last.Chan[0].stop) && (step.Chan[0].stop == last.Chan[0].stop));
+        CHECK((step.Chan[7].start == last.Chan[7].stop) && (step.Chan[7].stop == last.Chan[7].stop));
+    }
+    CHECK(sync_bulk_check());
+
+    CHECK((sync_bulk_header(&seq, &count) == BULK_BLOCK) && (seq == 6) && (count == 2));
+    for (i = 0; i < count; i++) {
+        sync_bulk_read(&step, 1);
+        CHECK((step.ticks == 1) && (step.Chan[0].start == 0) && (step.Chan[7].stop == 0));
+    }
+    CHECK(sync_bulk_check());
+    CHECK(stub_rx.empty());
+}
+
+/* A damaged block fails its CRC; the slave's NAK gets another pass and the
+   second copy comes through. */
+static void test_bulk_resend(void) {
+    byte seq;
+    word count;
+    unsigned bad;
+
+    send_pass();
+    stub_serial_later(0x55, 2000);      // a NAK, or what's left of several
+    CHECK(sync_bulk_end(FALSE));
+    bad = 4 + 2 * sizeof(sDimStep) + 2 + 4 + 5;
+    stub_tx[bad] ^= 0x10;               // inside sequence 1
+    stub_serial_loopback();
+    CHECK(read_block(&seq, &count) && (seq == 0));
+    CHECK(!read_block(&seq, &count) && (seq == 1));
+    CHECK(read_block(&seq, &count) && (seq == 2));
+    CHECK(sync_bulk_header(&seq, &count) == BULK_END_PASS);
+    sync_bulk_nak();
+    CHECK(stub_tx.size() == 7);
+    CHECK(stub_tx[1] == SYNC_NAK);
+    stub_tx.clear();
+
+    send_pass();
+    CHECK(!sync_bulk_end(TRUE));        // the last pass closes whatever the slaves say
+    stub_serial_loopback();
+    CHECK(read_block(&seq, &count) && (seq == 0));
+    CHECK(read_block(&seq, &count) && (seq == 1));
+    CHECK(read_block(&seq, &count) && (seq == 2));
+    CHECK(sync_bulk_header(&seq, &count) == BULK_END_CLOSE);
+}
+
+/* A master that stops part way through: every read gives up in bounded
+   time instead of hanging. */
+static void test_bulk_timeout(void) {
+    byte seq;
+    word count;
+    uint64_t start;
+
+    send_pass();
+    stub_tx.resize(4 + 2 * sizeof(sDimStep) - 3);
+    stub_serial_loopback();
+    start = stub_now_us;
+    CHECK(!read_block(&seq, &count));
+    CHECK(stub_now_us - start >= SYNC_BULK_TIMEOUT_MS * 1000);
+    CHECK(stub_now_us - start < 2 * SYNC_BULK_TIMEOUT_MS * 1000);
+
+    start = stub_now_us;
+    CHECK(sync_bulk_header(&seq, &count) == BULK_TIMEOUT);
+    CHECK(stub_now_us - start < 2 * SYNC_BULK_TIMEOUT_MS * 1000);
+
+    stub_tx.push_back(BULK_BYTE);       // a header cut short
+    stub_tx.push_back(1);
+    stub_serial_loopback();
+    CHECK(sync_bulk_header(&seq, &count) == BULK_TIMEOUT);
+}
+
+/* ---- latency: old text lines against a binary frame ---- */
+
+#define CHAR_BITS   10                  // start, 8 data, stop
+#define RUNS        100000
+
+static const char *old_wire;
+static int char_us;
+static char old_line[100];
+
+/* The old slave's vfnGetLine(), on characters as they come off the wire. */
+static void old_get_line(void) {
+    int num = 0;
+    char c;
+
+    while (((c = *old_wire++) != '\n') && num < 98) {
+        stub_now_us += char_us;
+        old_line[num] = c;
+        num++;
+    }
+    stub_now_us += char_us;             // the '\n'
+    old_line[num] = 0x00;
+}
+
+/* Microseconds from the first character of a restart until the slave has
+   the new speed, the old way, plus host time per line parsed. */
+static double old_latency(int baud, double *parse_us) {
+    int speed = 0;
+    clock_t t0;
+    int n;
+
+    char_us = 1000000 * CHAR_BITS / baud;
+    old_wire = "R\nC 123\n";
+    stub_now_us = 0;
+    old_get_line();
+    CHECK(old_line[0] == 'R');
+    old_get_line();
+    sscanf(old_line, "%*s %i", &speed);
+    CHECK(speed == 123);
+
+    t0 = clock();
+    for (n = 0; n < RUNS; n++) {
+        sscanf(old_line, "%*s %i", &speed);
+    }
+    *parse_us = (double)(clock() - t0) * 1000000 / CLOCKS_PER_SEC / RUNS;
+    return stub_now_us + *parse_us;
+}
+
+/* The same for one frame arriving a byte at a time into the receive
+   interrupt, plus host time per frame decoded. */
+static double new_latency(int baud, double *parse_us) {
+    std::deque<unsigned char> frame;
+    sSyncCmd cmd;
+    long wire_us;
+    clock_t t0;
+    int n;
+    unsigned i;
+
+    char_us = 1000000 * CHAR_BITS / baud;
+    drain();
+    sync_send(SYNC_RESTART, 0, 123);
+    frame = stub_tx;
+    stub_tx.clear();
+    wire_us = 0;                        // the stub's clock also counts polls of an empty port
+    for (i = 0; i < frame.size(); i++) {
+        wire_us += char_us;
+        stub_rx.push_back(frame[i]);
+        stub_serial_rx_irq();
+        CHECK(sync_get(&cmd) == (i + 1 == frame.size()));
+    }
+    CHECK((cmd.op == SYNC_RESTART) && (cmd.speed == 123));
+
+    t0 = clock();
+    for (n = 0; n < RUNS; n++) {
+        stub_rx.insert(stub_rx.end(), frame.begin(), frame.end());
+        for (i = 0; i < frame.size(); i++) {
+            stub_serial_rx_irq();
+        }
+        sync_get(&cmd);
+    }
+    *parse_us = (double)(clock() - t0) * 1000000 / CLOCKS_PER_SEC / RUNS;
+    return wire_us + *parse_us;
+}
+
+static void test_latency(void) {
+    double old_us, new_us, fast_us;
+    double old_parse, new_parse;
+
+    old_us = old_latency(9600, &old_parse);
+    new_us = new_latency(9600, &new_parse);
+    fast_us = new_latency(230400, &new_parse);
+    printf("  restart with a new speed: text at 9600 %.0f us, frame at 9600 %.0f us, at 230400 %.0f us\n",
+           old_us, new_us, fast_us);
+    printf("  host parse: sscanf %.3f us per line, frame %.3f us in the interrupt\n", old_parse, new_parse);
+    CHECK(new_us < old_us);
+    CHECK(fast_us < old_us / 10);
+}
+
+int main(void) {
+    sync_init(&port);
+    sync_listen();
+
+    test_round_trip();
+    test_corruption();
+    test_resync();
+    test_truncated();
+    test_mailbox_full();
+    test_negotiate_master();
+    test_negotiate_slave();
+    test_bulk_clean();
+    test_bulk_short();
+    test_bulk_resend();
+    test_bulk_timeout();
+    test_latency();
+    return TEST_DONE();
+}
@@ -0,0 +1,85 @@
+#include "mbed.h"
+#include "mbed_stats.h"
+#include "watermark.h"
+
+extern "C" byte __end__[];          /* Start of the heap. */
+extern "C" byte __ram_end__[];      /* End of RAM, as far as the heap can go. */
+extern "C" byte __StackLimit[];
+extern "C" byte __StackTop[];
+extern "C" caddr_t _sbrk(int incr);
+
+extern unsigned char *mbed_heap_start;  /* sbrk's bounds, see mbed_retarget.cpp */
+extern uint32_t mbed_heap_size;
+
+/* The stack grows down, so the lowest byte that isn't paint is its peak.
+   The heap grows up and its peak is the highest, or the break if that is
+   higher, as newlib doesn't write all of a block it hands out. The scans
+   only cover the
+   part of each region that still reads as paint and start again from the
+   far end once they reach the mark. */
+static byte *stack_mark;            /* Lowest stack byte seen in use. */
+static byte *stack_scan;            /* Next stack byte to look at. */
+static byte *heap_mark;             /* Just above the highest heap byte seen in use. */
+static byte *heap_scan;             /* Just above the next heap byte to look at. */
+
+void watermark_init(void) {
+    volatile byte *p;
+
+    stack_mark = (byte *)__get_MSP();
+    for (p = __StackLimit; p < stack_mark; p++) {
+        *p = WATERMARK_PAINT;
+    }
+    stack_scan = __StackLimit;
+
+    heap_mark = (byte *)_sbrk(0);
+    for (p = heap_mark; p < __ram_end__; p++) {
+        *p = WATERMARK_PAINT;
+    }
+    heap_scan = __ram_end__;
+
+    mbed_heap_start = __end__;
+    mbed_heap_size = __ram_end__ - __end__;
+}
+
+void watermark_service(void) {
+    const volatile byte *p;
+    byte *brk;
+    byte n;
+
+    p = stack_scan;
+    for (n = WATERMARK_CHUNK; (n > 0) && (p < stack_mark); n--, p++) {
+        if (*p != WATERMARK_PAINT) {
+            stack_mark = (byte *)p;
+            break;
+        }
+    }
+    stack_scan = (p < stack_mark) ? (byte *)p : __StackLimit;
+
+    p = heap_scan;
+    for (n = WATERMARK_CHUNK; (n > 0) && (p > heap_mark); n--) {
+        p--;
+        if (*p != WATERMARK_PAINT) {
+            heap_mark = (byte *)p + 1;
+            break;
+        }
+    }
+    heap_scan = (p > heap_mark) ? (byte *)p : __ram_end__;
+
+    brk = (byte *)_sbrk(0);
+    if (brk > heap_mark) {
+        heap_mark = brk;
+    }
+}
+
+void watermark_get(sWatermark *marks) {
+    marks->stack_peak = __StackTop - stack_mark;
+    marks->stack_size = __StackTop - __StackLimit;
+    marks->heap_peak = heap_mark - __end__;
+    marks->heap_size = __ram_end__ - __end__;
+}
+
+/* Without the RTOS mbed_stats_stack_get() asks us about the main stack. */
+extern "C" void mbed_stats_main_stack_get(mbed_stats_stack_t *stats) {
+    stats->max_size = __StackTop - stack_mark;
+    stats->reserved_size = __StackTop - __StackLimit;
+}
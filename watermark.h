@@ -0,0 +1,36 @@
+#ifndef WATERMARK_H
+#define WATERMARK_H
+
+#include "types.h"
+
+/* Peak stack and heap use, read back from a paint pattern.
+
+   watermark_init() paints the free stack (USB RAM from __StackLimit up to
+   the caller's frame) and the free heap (from the current break to the end
+   of RAM, which is also where it bounds sbrk now that the stack is no
+   longer above the heap). watermark_service() looks at WATERMARK_CHUNK
+   bytes of each from the main loop, so a mark can lag behind the real peak
+   for a pass but the loop is never held up. A used byte that happens to
+   hold WATERMARK_PAINT reads as untouched, which can hide a few bytes.
+
+   The stack figures are also what mbed_stats_stack_get() reports. */
+
+#define WATERMARK_PAINT 0xCD
+#define WATERMARK_CHUNK 32
+
+typedef struct {
+    word stack_peak;            /* Deepest the stack has been, in bytes. */
+    word stack_size;            /* __StackTop - __StackLimit */
+    word heap_peak;             /* Highest the heap has reached above __end__. */
+    word heap_size;             /* __end__ to the end of RAM */
+    } sWatermark;
+
+/* Once, early in main(), before anything is allocated if possible. */
+void watermark_init(void);
+
+/* From the main loop. */
+void watermark_service(void);
+
+void watermark_get(sWatermark *marks);
+
+#endif